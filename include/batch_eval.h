@@ -0,0 +1,42 @@
+/**
+ * @file batch_eval.h
+ * @brief   Handcrafted eval of many packed positions at once, for labelling datasets and tuning.
+ *
+ * The positions are never unpacked into Boards. Each thread decodes a chunk of CHUNK_SIZE positions into
+ * a structure of arrays (a mailbox and the piece bitboards, position index innermost) and then runs every
+ * term of the eval over the whole chunk:
+ *
+ *      piece square    one gather per square from psqt::table across the positions (AVX2 if the build has it)
+ *      phase           popcounts of the piece bitboards
+ *      pawns           popcounts of the pawns per file
+ *      activity        evalActivity per position, the attacks are set-wise per piece type (pieceTypeAttacks)
+ *
+ * The loops over the chunk have no dependencies between positions, so the compiler vectorizes the popcounts
+ * where the target has a vector popcount. The scores are the same as evalPosition<color>(board) of the unpacked
+ * position, relative to the side to move.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+#include "board/packed_position.h"
+
+namespace batch_eval {
+
+// positions per chunk, the SoA of one chunk (mailbox and bitboards) is about 20 KB
+// (8 KB mailbox, 12 KB bitboards) and stays in L1
+constexpr size_t CHUNK_SIZE = 128;
+
+/**
+ * @brief   Evaluate every position, scores[i] belongs to positions[i]. Throws a runtime_error if a position
+ *          is not valid (PackedPosition::isValid) or scores is too short, before anything is evaluated.
+ *
+ * @param positions
+ * @param scores    at least as many entries as positions
+ * @param threads   number of threads the chunks are spread over, 0 for all hardware threads
+ */
+void evaluate(std::span<const PackedPosition> positions, std::span<double> scores, unsigned threads = 0);
+
+} // namespace batch_eval
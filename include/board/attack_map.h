@@ -0,0 +1,86 @@
+/**
+ * @file attack_map.h
+ * @brief   Per side attack bitboards and attacker counts that Board keeps up to date through move / undo.
+ *
+ * A move only changes a few squares (from, to, the ep victim, the castling rook). The attacks of the pieces
+ * on those squares are recomputed, and so are the attacks of every slider whose rays reach one of them,
+ * as its ray just got longer or shorter. Pawns, knights and kings elsewhere on the board are unaffected.
+ *
+ * The map is optional (Board::setAttackMap), keeping it is not free and perft does not need it.
+ * Eval (mobility, king safety), legality and SEE can read the attacks without generating them.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "definitions.h"
+#include "bitboard.h"
+
+class Board;
+
+class AttackMap {
+    // attacks of the piece on each square, empty squares attack nothing
+    std::array<u64, 64> attacks_from {};
+
+    // number of pieces of each side that attack a square
+    std::array<std::array<uint8_t, 64>, 2> counts {};
+
+    // squares with a count > 0, per side
+    std::array<u64, 2> attacked {};
+
+    // squares whose attacks are currently in the map, per side
+    std::array<u64, 2> sources {};
+
+public:
+    /**
+     * @brief   Recompute the whole map from scratch.
+     *
+     * @param board
+     */
+    void init(const Board& board);
+
+    /**
+     * @brief   Bring the map up to date after the pieces on some squares changed.
+     *          Called by Board after the bitboards were updated, for make and unmake alike.
+     *
+     * @param board     the board after the change
+     * @param changed   squares that got a piece, lost a piece or both
+     */
+    void update(const Board& board, u64 changed);
+
+    /**
+     * @brief   All squares attacked by a side
+     *
+     * @tparam color
+     * @return u64
+     */
+    template <Color color>
+    constexpr u64 getAttacks() const { return attacked[side<color>()]; }
+
+    /**
+     * @brief   Number of pieces of a side that attack a square
+     *
+     * @tparam color
+     * @param square
+     * @return int
+     */
+    template <Color color>
+    constexpr int getCount(int square) const { return counts[side<color>()][square]; }
+
+    /**
+     * @brief   Attacks of the piece on a square, 0 for an empty square
+     *
+     * @param square
+     * @return u64
+     */
+    constexpr u64 getAttacksFrom(int square) const { return attacks_from[square]; }
+
+private:
+    template <Color color>
+    static constexpr int side() { return utils::isWhite(color) ? 0 : 1; }
+
+    void addSource(const Board& board, int square);
+    void removeSource(int square);
+};
@@ -1,23 +1,34 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stack>
+#include <optional>
+#include <algorithm>
 
 #include "definitions.h"
 #include "bitboard.h"
 #include "move.h"
 #include "config.h"
+#include "attack_map.h"
+#include "packed_position.h"
+#include "psqt.h"
+#include "nnue/accumulator.h"
 
 struct State {
     Color cur_color;
 
     uint64_t zobrist_hash;
+    uint64_t pawn_hash;     // only the pawn keys, indexes the pawn hash table
 
     std::array<uint64_t, 14> pieces = { 0ULL };
     std::array<Piece, 64> mailbox { Piece::none };
     uint64_t ep_field;
 
+    Score psqt;             // material and piece square tables of both sides, white positive
+    int phase;              // psqt::MAX_PHASE with all pieces on the board, 0 with only kings and pawns
+
     union {
         struct {
             bool white_qs : 1;
@@ -39,29 +50,186 @@ struct MoveState {
     Piece moving_piece = Piece::none;
     Piece captured_piece = Piece::none;
     Piece promotion_piece = Piece::none;
+    int half_move_clock = 0;
 
     MoveState() = default;
 };
 
+/**
+ * @brief   A position with its move history. Boards are plain values: copies are independent and can be
+ *          handed to other threads, nothing is shared and nothing leaks.
+ *
+ *          sizeof(Board) is about 2.2KB with libstdc++: the State (~400 bytes), the key ring (1KB),
+ *          the optional attack map (~700 bytes) and the move stack (80 bytes + its heap storage).
+ *          A copy also copies the whole move stack, clone() only copies what the new owner can use.
+ */
 class Board {
-    State* state;
+    State state;
     std::stack<MoveState> move_history;
+
+    // only kept if enabled, move / undo update it
+    std::optional<AttackMap> attack_map;
+
+    // only kept if enabled, move pushes a ply, undo pops it, nnue::evaluate computes the accumulators
+    std::optional<nnue::AccumulatorStack> accumulators;
+
+    // the ply move is filling in, the piece operations record into it. null outside of move
+    nnue::DirtyPiece* dirty_piece = nullptr;
+
+    // keys of the positions before each move, a repetition can only reach back to the last pawn move or capture,
+    // that is at most 100 plies (the 50 move rule), so a ring of 128 keys is enough
+    static constexpr uint32_t KEY_HISTORY_SIZE = 128;
+    std::array<uint64_t, KEY_HISTORY_SIZE> key_history;
+    uint32_t key_count = 0;
 public:
     Board() : Board(STARTPOS) { }
-    Board(const std::string& fen);
+    Board(std::string_view fen);
+
+    /**
+     * @brief   Load a position into this board, without any allocations. The move history is cleared.
+     *          The clocks are optional, anything after the fields of the fen (EPD operations) is not parsed.
+     *          Throws a runtime_error if the fen is malformed.
+     *
+     * @param fen
+     * @return size_t   number of characters that belonged to the fen
+     */
+    size_t setFen(std::string_view fen);
 
     std::string getFen() const;
 
-    inline uint64_t getZobristKey() const { return state->zobrist_hash; }
-    inline bool whiteTurn() const { return utils::isWhite(state->cur_color); }
+    /**
+     * @brief   A copy for another search or thread. It has the same position and the keys back to the last
+     *          pawn move or capture (all a repetition can reach), but no move stack:
+     *          the clone can not undo past the current position.
+     *
+     * @return Board
+     */
+    Board clone() const;
+
+    /**
+     * @brief   Encode the position into 32 bytes, see packed_position.h
+     *          Throws a runtime_error for more than 32 pieces, setFen never builds such a board.
+     *
+     * @return PackedPosition
+     */
+    PackedPosition pack() const;
+
+    /**
+     * @brief   Load a packed position into this board. The move history is cleared.
+     *          Throws a runtime_error if the record is not valid (PackedPosition::isValid).
+     *
+     * @param packed
+     */
+    void unpack(const PackedPosition& packed);
+
+    inline uint64_t getZobristKey() const { return state.zobrist_hash; }
+    inline uint64_t getPawnKey() const { return state.pawn_hash; }
+    inline Score getPsqt() const { return state.psqt; }
+    inline int getPhase() const { return state.phase; }
+    inline bool whiteTurn() const { return utils::isWhite(state.cur_color); }
+
+    constexpr int getHalfMoveClock() const { return state.half_move_clock; }
+    constexpr int getFullMoveClock() const { return state.full_move_clock; }
+
+    /**
+     * @brief   Did the current position occur before? Only positions since the last pawn move or capture
+     *          (and since the fen was loaded) can repeat, and only with the same side to move,
+     *          so we step back two plies at a time starting 4 plies ago.
+     *          A single repetition already counts, the search can not do better than repeating again.
+     *
+     * @return true     if the position is a repetition
+     */
+    inline bool isRepetition() const
+    {
+        const uint32_t reach = std::min<uint32_t>({ static_cast<uint32_t>(state.half_move_clock), key_count, KEY_HISTORY_SIZE });
+        for ( uint32_t plies = 4; plies <= reach; plies += 2 ) {
+            if ( key_history[(key_count - plies) % KEY_HISTORY_SIZE] == state.zobrist_hash ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief   Draw by repetition or the 50 move rule.
+     *          Does not check if the move that reached the 100th ply gave mate, the search does not get that far.
+     *
+     * @return true     if the position is a draw
+     */
+    inline bool isDraw() const { return state.half_move_clock >= 100 || isRepetition(); }
 
     template <Color color> void move(const Move& move);
     template <Color color> void undo(const Move& move);
 
+    /**
+     * @brief   Make / unmake a move whose flag is known at compile time.
+     *          The generic versions dispatch to these, so there is no branching on the flag left inside.
+     *
+     * @tparam color    color to move
+     * @tparam flag     flag of the move, has to match move.getFlag()
+     */
+    template <Color color, Move::Flag flag> void move(const Move& move);
+    template <Color color, Move::Flag flag> void undo(const Move& move);
+
+    /**
+     * @brief   Start or stop keeping the attack map up to date, starting builds it from scratch.
+     *
+     * @param enabled
+     */
+    void setAttackMap(bool enabled);
+
+    constexpr bool hasAttackMap() const { return attack_map.has_value(); }
+
+    /**
+     * @brief   The incrementally updated attacks of both sides, only valid if hasAttackMap()
+     *
+     * @return const AttackMap&
+     */
+    constexpr const AttackMap& getAttackMap() const { return *attack_map; }
+
+    /**
+     * @brief   Start or stop keeping the NNUE accumulator stack, starting clears it (see nnue/accumulator.h).
+     *
+     * @param enabled
+     */
+    void setNnue(bool enabled);
+
+    constexpr bool hasNnue() const { return accumulators.has_value(); }
+
+    /**
+     * @brief   The accumulators of every ply, only valid if hasNnue()
+     *
+     * @return nnue::AccumulatorStack&
+     */
+    constexpr nnue::AccumulatorStack& getAccumulators() { return *accumulators; }
+
     template <Color color>
     constexpr bool isCheck(uint64_t enemy_attacks) const { return (enemy_attacks & getPieces<PieceType::king, color>()) != NULL_BB; }
 
-    char getRawCastlingRights() const { return state->castling_rights.raw; }
+    /**
+     * @brief   Checks if a move could have been generated in this position, without generating any moves.
+     *          Moves from the TT or killer slots can be stale or come from a hash collision,
+     *          so they have to pass this before they are played. Does not check if the own king is left in check.
+     *          Implemented in move_generator/legality_impl.hpp, as it needs the attack tables.
+     *
+     * @tparam color    color to move
+     * @param move      any 16 bit move
+     * @return true     if the move is pseudolegal
+     */
+    template <Color color> bool isPseudoLegal(const Move& move) const;
+
+    /**
+     * @brief   Checks if a pseudolegal move leaves the own king in check,
+     *          without making the move on the board.
+     *
+     * @tparam color    color to move
+     * @param move      a move that passed isPseudoLegal (or came from the move generator)
+     * @return true     if the move is legal
+     */
+    template <Color color> bool isLegal(const Move& move) const;
+
+    char getRawCastlingRights() const { return state.castling_rights.raw; }
 
     /**
      * @brief Get the index of the piece board
@@ -108,7 +276,7 @@ public:
      */
     constexpr Piece getPiece(int square) const
     {
-        return state->mailbox[square];
+        return state.mailbox[square];
     }
 
     /**
@@ -144,7 +312,7 @@ public:
      */
     constexpr uint64_t getEpField() const
     {
-        return state->ep_field;
+        return state.ep_field;
     }
 
     /**
@@ -174,7 +342,7 @@ public:
      */
     constexpr uint64_t getOccupancy() const
     {
-        return state->pieces[12] | state->pieces[13];
+        return state.pieces[12] | state.pieces[13];
     }
 
     /**
@@ -188,7 +356,7 @@ public:
     {
         constexpr Color enemy_color = utils::switchColor(color);
         constexpr int enemy_idx = getIndex<PieceType::none, enemy_color>();
-        return state->pieces[enemy_idx];
+        return state.pieces[enemy_idx];
     }
 
     /**
@@ -225,8 +393,8 @@ public:
     template <Color color>
     constexpr bool canCastleQs() const
     {
-        if constexpr ( utils::isWhite(color) ) return state->castling_rights.white_qs != 0;
-        else return state->castling_rights.black_qs != 0;
+        if constexpr ( utils::isWhite(color) ) return state.castling_rights.white_qs != 0;
+        else return state.castling_rights.black_qs != 0;
     }
 
     /**
@@ -239,8 +407,8 @@ public:
     template <Color color>
     constexpr bool canCastleKs() const
     {
-        if constexpr ( utils::isWhite(color) ) return state->castling_rights.white_ks != 0;
-        else return state->castling_rights.black_ks != 0;
+        if constexpr ( utils::isWhite(color) ) return state.castling_rights.white_ks != 0;
+        else return state.castling_rights.black_ks != 0;
     }
 
     /**
@@ -282,15 +450,15 @@ public:
     template <Color color>
     constexpr void removeCastleKs()
     {
-        if constexpr ( utils::isWhite(color) ) state->castling_rights.white_ks = 0;
-        else state->castling_rights.black_ks = 0;
+        if constexpr ( utils::isWhite(color) ) state.castling_rights.white_ks = 0;
+        else state.castling_rights.black_ks = 0;
     }
 
     template <Color color>
     constexpr void removeCastleQs()
     {
-        if constexpr ( utils::isWhite(color) ) state->castling_rights.white_qs = 0;
-        else state->castling_rights.black_qs = 0;
+        if constexpr ( utils::isWhite(color) ) state.castling_rights.white_qs = 0;
+        else state.castling_rights.black_qs = 0;
     }
 
     template <Color color>
@@ -312,11 +480,20 @@ public:
     std::string toString() const;
 
 private:
+    // for clone, the caller fills in everything
+    struct Uninitialized { };
+    explicit Board(Uninitialized) { }
 
-    template <Color color>
+    // empty board, white to move, all castling rights, no history
+    void clear();
+
+    template <Color color, Move::Flag flag>
     void storeState(const Move& move);
 
-    constexpr void switchColor() { state->cur_color = utils::switchColor(state->cur_color); }
+    template <Color color, Move::Flag flag>
+    inline void updateAttackMap(const Move& move);
+
+    constexpr void switchColor() { state.cur_color = utils::switchColor(state.cur_color); }
 
     template <Color color, bool is_capture>
     inline void tryToRemoveCastlingRights(const Move& move);
@@ -34,10 +34,10 @@ constexpr uint64_t Board::getPieces() const
 {
     constexpr int index = getIndex<type, color>();
     if constexpr ( index == 14 ) {
-        return state->pieces[12] | state->pieces[13];
+        return state.pieces[12] | state.pieces[13];
     }
     else {
-        return state->pieces[index];
+        return state.pieces[index];
     }
 }
 
@@ -64,15 +64,26 @@ constexpr void Board::movePiece(uint64_t from, uint64_t to)
 
     const uint64_t mask = from_mask | to_mask;
 
-    state->pieces[piece_index] ^= mask;
+    state.pieces[piece_index] ^= mask;
 
-    state->mailbox[from] = Piece::none;
-    state->mailbox[to] = piece;
+    state.mailbox[from] = Piece::none;
+    state.mailbox[to] = piece;
 
-    state->pieces[occupancy_index] ^= mask;
+    state.pieces[occupancy_index] ^= mask;
 
-    Zobrist::togglePiece(state->zobrist_hash, piece_index, from);
-    Zobrist::togglePiece(state->zobrist_hash, piece_index, to);
+    Zobrist::togglePiece(state.zobrist_hash, piece_index, from);
+    Zobrist::togglePiece(state.zobrist_hash, piece_index, to);
+
+    state.psqt += psqt::table[piece_index][to] - psqt::table[piece_index][from];
+
+    if ( dirty_piece ) {
+        dirty_piece->add(piece, from, to);
+    }
+
+    if constexpr ( type == PieceType::pawn ) {
+        Zobrist::togglePiece(state.pawn_hash, piece_index, from);
+        Zobrist::togglePiece(state.pawn_hash, piece_index, to);
+    }
 }
 
 // IMPORTANT! square is assumed to be the index of the piece, not the bitboard with the bit already set!
@@ -83,12 +94,23 @@ constexpr void Board::removePiece(uint64_t square)
     constexpr int occ_index = getIndex<PieceType::none, color>();
     const uint64_t mask = ~single_bit_u64(square);
 
-    state->pieces[piece_index] &= mask;
-    state->pieces[occ_index] &= mask;
+    state.pieces[piece_index] &= mask;
+    state.pieces[occ_index] &= mask;
+
+    state.mailbox[square] = Piece::none;
+
+    Zobrist::togglePiece(state.zobrist_hash, piece_index, square);
 
-    state->mailbox[square] = Piece::none;
+    state.psqt -= psqt::table[piece_index][square];
+    state.phase -= psqt::phase_weight[piece_index];
 
-    Zobrist::togglePiece(state->zobrist_hash, piece_index, square);
+    if ( dirty_piece ) {
+        dirty_piece->add(utils::getPiece(type, color), square, nnue::DirtyPiece::NO_SQUARE);
+    }
+
+    if constexpr ( type == PieceType::pawn ) {
+        Zobrist::togglePiece(state.pawn_hash, piece_index, square);
+    }
 }
 
 // IMPORTANT! square is assumed to be the index of the piece, not the bitboard with the bit already set!
@@ -100,12 +122,23 @@ constexpr void Board::placePiece(uint64_t square)
     const int piece_index = getIndex<type, color>();
     const uint64_t mask = single_bit_u64(square);
 
-    state->mailbox[square] = piece;
-    state->pieces[piece_index] |= mask;
+    state.mailbox[square] = piece;
+    state.pieces[piece_index] |= mask;
+
+    state.pieces[occupancy_index] |= mask;
 
-    state->pieces[occupancy_index] |= mask;
+    Zobrist::togglePiece(state.zobrist_hash, piece_index, square);
+
+    state.psqt += psqt::table[piece_index][square];
+    state.phase += psqt::phase_weight[piece_index];
+
+    if ( dirty_piece ) {
+        dirty_piece->add(piece, nnue::DirtyPiece::NO_SQUARE, square);
+    }
 
-    Zobrist::togglePiece(state->zobrist_hash, piece_index, square);
+    if constexpr ( type == PieceType::pawn ) {
+        Zobrist::togglePiece(state.pawn_hash, piece_index, square);
+    }
 }
 
 template <Color color>
@@ -115,12 +148,23 @@ constexpr void Board::removePiece(Piece piece, uint64_t square)
     const int piece_index = getIndex(piece);
     const uint64_t mask = ~single_bit_u64(square);
 
-    state->mailbox[square] = Piece::none;
-    state->pieces[piece_index] &= mask;
+    state.mailbox[square] = Piece::none;
+    state.pieces[piece_index] &= mask;
+
+    state.pieces[occupancy_index] &= mask;
 
-    state->pieces[occupancy_index] &= mask;
+    Zobrist::togglePiece(state.zobrist_hash, piece_index, square);
 
-    Zobrist::togglePiece(state->zobrist_hash, piece_index, square);
+    state.psqt -= psqt::table[piece_index][square];
+    state.phase -= psqt::phase_weight[piece_index];
+
+    if ( dirty_piece ) {
+        dirty_piece->add(piece, square, nnue::DirtyPiece::NO_SQUARE);
+    }
+
+    if ( utils::getPieceType(piece) == PieceType::pawn ) {
+        Zobrist::togglePiece(state.pawn_hash, piece_index, square);
+    }
 }
 
 template <Color color>
@@ -130,12 +174,23 @@ constexpr void Board::placePiece(Piece piece, uint64_t square)
     const int piece_index = getIndex(piece);
     const uint64_t mask = single_bit_u64(square);
 
-    state->mailbox[square] = piece;
-    state->pieces[piece_index] |= mask;
+    state.mailbox[square] = piece;
+    state.pieces[piece_index] |= mask;
+
+    state.pieces[occupancy_index] |= mask;
 
-    state->pieces[occupancy_index] |= mask;
+    Zobrist::togglePiece(state.zobrist_hash, piece_index, square);
 
-    Zobrist::togglePiece(state->zobrist_hash, piece_index, square);
+    state.psqt += psqt::table[piece_index][square];
+    state.phase += psqt::phase_weight[piece_index];
+
+    if ( dirty_piece ) {
+        dirty_piece->add(piece, nnue::DirtyPiece::NO_SQUARE, square);
+    }
+
+    if ( utils::getPieceType(piece) == PieceType::pawn ) {
+        Zobrist::togglePiece(state.pawn_hash, piece_index, square);
+    }
 }
 
 template <Color color>
@@ -149,36 +204,104 @@ constexpr void Board::movePiece(Piece piece, uint64_t from, uint64_t to)
 
     const uint64_t mask = from_mask | to_mask;
 
-    state->pieces[piece_index] ^= mask;
+    state.pieces[piece_index] ^= mask;
+
+    state.mailbox[from] = Piece::none;
+    state.mailbox[to] = piece;
+
+    state.pieces[occupancy_index] ^= mask;
 
-    state->mailbox[from] = Piece::none;
-    state->mailbox[to] = piece;
+    Zobrist::togglePiece(state.zobrist_hash, piece_index, from);
+    Zobrist::togglePiece(state.zobrist_hash, piece_index, to);
 
-    state->pieces[occupancy_index] ^= mask;
+    state.psqt += psqt::table[piece_index][to] - psqt::table[piece_index][from];
 
-    Zobrist::togglePiece(state->zobrist_hash, piece_index, from);
-    Zobrist::togglePiece(state->zobrist_hash, piece_index, to);
+    if ( dirty_piece ) {
+        dirty_piece->add(piece, from, to);
+    }
+
+    if ( utils::getPieceType(piece) == PieceType::pawn ) {
+        Zobrist::togglePiece(state.pawn_hash, piece_index, from);
+        Zobrist::togglePiece(state.pawn_hash, piece_index, to);
+    }
 }
 
 
-template <Color color>
+template <Color color, Move::Flag flag>
 void Board::storeState(const Move& move)
 {
+    constexpr Move flag_move(0, 0, flag);
     MoveState new_state;
 
-    const uint64_t from = move.getFrom();
-    const uint64_t to = move.getTo();
+    // only quiets and captures have to look up the moving piece, every other flag implies it
+    if constexpr ( flag == Move::Flag::quiet || flag == Move::Flag::capture ) {
+        new_state.moving_piece = getPiece(move.getFrom());
+    }
+    else if constexpr ( flag_move.isCastle() ) {
+        new_state.moving_piece = utils::getPiece(PieceType::king, color);
+    }
+    else {
+        new_state.moving_piece = utils::getPiece(PieceType::pawn, color);
+    }
 
-    new_state.moving_piece = getPiece(from);
-    new_state.captured_piece = getPiece(to);
-    new_state.promotion_piece = move.getPromotionPiece<color>();
+    if constexpr ( flag == Move::Flag::ep ) {
+        new_state.captured_piece = utils::getPiece(PieceType::pawn, utils::switchColor(color));
+    }
+    else if constexpr ( flag_move.isCapture() ) {
+        new_state.captured_piece = getPiece(move.getTo());
+    }
+
+    if constexpr ( flag_move.isPromotion() ) {
+        new_state.promotion_piece = flag_move.getPromotionPiece<color>();
+    }
 
-    new_state.ep_field = state->ep_field;
-    new_state.zobrist_hash = state->zobrist_hash;
+    new_state.ep_field = state.ep_field;
+    new_state.zobrist_hash = state.zobrist_hash;
 
-    new_state.castling_rights = state->castling_rights.raw;
+    new_state.castling_rights = state.castling_rights.raw;
+    new_state.half_move_clock = state.half_move_clock;
 
     move_history.push(new_state);
+    key_history[key_count++ % KEY_HISTORY_SIZE] = state.zobrist_hash;
+
+    // 50 move rule: pawn moves and captures reset the clock
+    if constexpr ( flag == Move::Flag::quiet ) {
+        const bool is_pawn = new_state.moving_piece == utils::getPiece(PieceType::pawn, color);
+        state.half_move_clock = is_pawn ? 0 : state.half_move_clock + 1;
+    }
+    else if constexpr ( flag_move.isCastle() ) {
+        ++state.half_move_clock;
+    }
+    else {
+        state.half_move_clock = 0;
+    }
+
+    if constexpr ( !utils::isWhite(color) ) {
+        ++state.full_move_clock;
+    }
+}
+
+template <Color color, Move::Flag flag>
+inline void Board::updateAttackMap(const Move& move)
+{
+    if ( !attack_map ) {
+        return;
+    }
+
+    constexpr bool is_white = utils::isWhite(color);
+    u64 changed = single_bit_u64(move.getFrom()) | single_bit_u64(move.getTo());
+
+    if constexpr ( flag == Move::Flag::ep ) {
+        changed |= single_bit_u64(move.getTo() + (is_white ? -8 : 8));
+    }
+    else if constexpr ( flag == Move::Flag::castle_k ) {
+        changed |= is_white ? 0xA0ULL : (0xA0ULL << 56);    // h1 / f1
+    }
+    else if constexpr ( flag == Move::Flag::castle_q ) {
+        changed |= is_white ? 0x09ULL : (0x09ULL << 56);    // a1 / d1
+    }
+
+    attack_map->update(*this, changed);
 }
 
 // ================================
@@ -220,73 +343,84 @@ inline void Board::tryToRemoveCastlingRights(const Move& move)
 
         if ( to == enemy_rook_k ) {
             removeCastleKs<enemy_color>();
-
-            Zobrist::toggleCastlingKs<enemy_color>(state->zobrist_hash);
         }
         else if ( to == enemy_rook_q ) {
             removeCastleQs<enemy_color>();
-
-            Zobrist::toggleCastlingQs<enemy_color>(state->zobrist_hash);
         }
     }
 
     if ( from == my_rook_k ) {
         removeCastleKs<my_color>();
-
-        Zobrist::toggleCastlingKs<my_color>(state->zobrist_hash);
     }
     else if ( from == my_rook_q ) {
         removeCastleQs<my_color>();
-
-        Zobrist::toggleCastlingQs<my_color>(state->zobrist_hash);
     }
     else if ( moving_piece == king ) {
         removeCastle<my_color>();
-
-        Zobrist::toggleCastling<my_color>(state->zobrist_hash);
     }
 }
 
 // ================================
 // make move / unmake move
 // ================================
+// every flag gets its own instantiation, the branches on the flag are resolved at compile time.
+// the generic versions below only dispatch on the runtime flag (a single jump table),
+// callers that already know the flag can call move<color, flag> directly.
+
 template <Color color>
 void Board::move(const Move& move)
 {
-    storeState<color>(move);
-    auto cur_state = move_history.top();
+    Move::dispatch(move.getFlag(), [&]<Move::Flag flag>() { this->move<color, flag>(move); });
+}
+
+template <Color color>
+void Board::undo(const Move& move)
+{
+    Move::dispatch(move.getFlag(), [&]<Move::Flag flag>() { this->undo<color, flag>(move); });
+}
+
+template <Color color, Move::Flag flag>
+void Board::move(const Move& move)
+{
+    storeState<color, flag>(move);
+    const MoveState& cur_state = move_history.top();
+
+    if ( accumulators ) {
+        dirty_piece = &accumulators->push();
+    }
 
     constexpr Color my_color = color;
     constexpr Color enemy_color = utils::switchColor(color);
+    constexpr Move flag_move(0, 0, flag);
 
     const uint64_t move_to = move.getTo();
     const uint64_t move_from = move.getFrom();
-    const Move::Flag move_flag = move.getFlag();
-
-    const Piece moving_piece = cur_state.moving_piece;
-    const Piece captured_piece = cur_state.captured_piece;
 
     constexpr auto pawn_push_function = (utils::isWhite(my_color) ? north : south);
 
-    Zobrist::toggleBlackToMove(state->zobrist_hash);
-    Zobrist::toggleEnPassant(state->zobrist_hash, state->ep_field);
+    Zobrist::toggleBlackToMove(state.zobrist_hash);
+    Zobrist::toggleEnPassant(state.zobrist_hash, state.ep_field);
 
-    if ( move_flag == Move::Flag::pawn_push ) {
+    if constexpr ( flag == Move::Flag::pawn_push ) {
         movePiece<PieceType::pawn, my_color>(move_from, move_to);
         const uint64_t new_ep_field = pawn_push_function(1ULL << move_from);
 
-        state->ep_field = new_ep_field;
-        state->cur_color = enemy_color;
+        state.ep_field = new_ep_field;
+        state.cur_color = enemy_color;
+
+        Zobrist::toggleEnPassant(state.zobrist_hash, new_ep_field);
+        updateAttackMap<color, flag>(move);
+        dirty_piece = nullptr;
 
         return; // early exit because we set the ep field
     }
 
-    else if ( move_flag == Move::Flag::quiet ) {
-        movePiece<my_color>(moving_piece, move_from, move_to);
+    else if constexpr ( flag == Move::Flag::quiet ) {
+        movePiece<my_color>(cur_state.moving_piece, move_from, move_to);
         tryToRemoveCastlingRights<my_color, false>(move);
     }
 
-    else if ( move_flag == Move::Flag::castle_k ) {
+    else if constexpr ( flag == Move::Flag::castle_k ) {
         constexpr int rook_from = (utils::isWhite(my_color) ? 7 : 63);
         constexpr int rook_to = (utils::isWhite(my_color) ? 5 : 61);
 
@@ -294,11 +428,9 @@ void Board::move(const Move& move)
         movePiece<PieceType::rook, my_color>(rook_from, rook_to);
 
         removeCastle<my_color>();
-
-        Zobrist::toggleCastlingKs<my_color>(state->zobrist_hash);
     }
 
-    else if ( move_flag == Move::Flag::castle_q ) {
+    else if constexpr ( flag == Move::Flag::castle_q ) {
         constexpr int rook_from = (utils::isWhite(my_color) ? 0 : 56);
         constexpr int rook_to = (utils::isWhite(my_color) ? 3 : 59);
 
@@ -306,40 +438,47 @@ void Board::move(const Move& move)
         movePiece<PieceType::rook, my_color>(rook_from, rook_to);
 
         removeCastle<my_color>();
-
-        Zobrist::toggleCastlingQs<my_color>(state->zobrist_hash);
     }
 
-    else if ( move_flag == Move::Flag::capture ) {
+    else if constexpr ( flag == Move::Flag::capture ) {
+        const Piece moving_piece = cur_state.moving_piece;
+
         movePiece<color>(moving_piece, move_from, move_to);
-        removePiece<enemy_color>(captured_piece, move_to);
-        state->mailbox[move_to] = moving_piece;
+        removePiece<enemy_color>(cur_state.captured_piece, move_to);
+        state.mailbox[move_to] = moving_piece;
 
         tryToRemoveCastlingRights<my_color, true>(move);
     }
 
-    else if ( move_flag == Move::Flag::ep ) {
+    else if constexpr ( flag == Move::Flag::ep ) {
         constexpr int offset = (utils::isWhite(my_color) ? -8 : 8);
         const uint64_t enemy_square = move_to + offset;
         movePiece<PieceType::pawn, my_color>(move_from, move_to);
         removePiece<PieceType::pawn, enemy_color>(enemy_square);
     }
 
-    else if ( move_flag == Move::Flag::promo_n || move_flag == Move::Flag::promo_b || move_flag == Move::Flag::promo_r || move_flag == Move::Flag::promo_q || move_flag == Move::Flag::promo_x_n || move_flag == Move::Flag::promo_x_b || move_flag == Move::Flag::promo_x_r || move_flag == Move::Flag::promo_x_q ) {
-        if ( move.isCapture() ) {
-            removePiece<enemy_color>(captured_piece, move_to);
+    else if constexpr ( flag_move.isPromotion() ) {
+        constexpr PieceType promotion_type = flag_move.getPromotionPieceType();
+
+        if constexpr ( flag_move.isCapture() ) {
+            removePiece<enemy_color>(cur_state.captured_piece, move_to);
             tryToRemoveCastlingRights<my_color, true>(move);
         }
 
         removePiece<PieceType::pawn, my_color>(move_from);
-        placePiece<my_color>(cur_state.promotion_piece, move_to);
+        placePiece<promotion_type, my_color>(move_to);
     }
 
-    state->ep_field = 0ULL;
-    state->cur_color = enemy_color;
+    Zobrist::updateCastling(state.zobrist_hash, cur_state.castling_rights, state.castling_rights.raw);
+
+    state.ep_field = 0ULL;
+    state.cur_color = enemy_color;
+
+    updateAttackMap<color, flag>(move);
+    dirty_piece = nullptr;
 }
 
-template <Color color>
+template <Color color, Move::Flag flag>
 void Board::undo(const Move& move)
 {
     if ( move_history.empty() ) {
@@ -349,70 +488,65 @@ void Board::undo(const Move& move)
     constexpr bool is_white = utils::isWhite(color);
     constexpr Color my_color = color;
     constexpr Color enemy_color = utils::switchColor(color);
+    constexpr Move flag_move(0, 0, flag);
 
-    MoveState last_state = move_history.top();
-    move_history.pop();
+    const MoveState& last_state = move_history.top();
+
+    state.cur_color = my_color;
+    state.ep_field = last_state.ep_field;
+    state.castling_rights.raw = last_state.castling_rights;
+    state.half_move_clock = last_state.half_move_clock;
+    --key_count;
 
-    state->cur_color = enemy_color;
-    state->ep_field = last_state.ep_field;
-    state->castling_rights.raw = last_state.castling_rights;
+    if constexpr ( !is_white ) {
+        --state.full_move_clock;
+    }
 
     const uint64_t move_to = move.getTo();
     const uint64_t move_from = move.getFrom();
-    const Move::Flag move_flag = move.getFlag();
-
-    const Piece captured_piece = last_state.captured_piece;
 
     constexpr int ep_offset = (is_white ? -8 : 8);
 
-    Zobrist::toggleBlackToMove(state->zobrist_hash);
-    Zobrist::toggleEnPassant(state->zobrist_hash, state->ep_field);
-
-    // undo normal moves
-    switch ( move_flag ) {
-        case Move::Flag::quiet:
-        case Move::Flag::pawn_push:
-        case Move::Flag::capture:
-        case Move::Flag::ep: {
-            movePiece<my_color>(getPiece(move_to), move_to, move_from);
-        } break;
-        default: break;
-    }
-
-    if ( move.isCastle() ) {
-        if ( move_flag == Move::Flag::castle_k ) {
-            constexpr int rook_from = (utils::isWhite(my_color) ? 7 : 63);
-            constexpr int rook_to = (utils::isWhite(my_color) ? 5 : 61);
-
-            movePiece<PieceType::rook, my_color>(rook_to, rook_from);
-        }
-        else if ( move_flag == Move::Flag::castle_q ) {
-            constexpr int rook_from = (utils::isWhite(my_color) ? 0 : 56);
-            constexpr int rook_to = (utils::isWhite(my_color) ? 3 : 59);
+    if constexpr ( flag == Move::Flag::quiet || flag == Move::Flag::capture ) {
+        movePiece<my_color>(getPiece(move_to), move_to, move_from);
 
-            movePiece<PieceType::rook, my_color>(rook_to, rook_from);
+        if constexpr ( flag == Move::Flag::capture ) {
+            placePiece<enemy_color>(last_state.captured_piece, move_to);
         }
-
-        Zobrist::toggleCastling<my_color>(state->zobrist_hash);
-        movePiece<PieceType::king, my_color>(move_to, move_from);
-        return;
     }
-    else if ( move.isEnpassant() ) {
+    else if constexpr ( flag == Move::Flag::pawn_push ) {
+        movePiece<PieceType::pawn, my_color>(move_to, move_from);
+    }
+    else if constexpr ( flag == Move::Flag::ep ) {
+        movePiece<PieceType::pawn, my_color>(move_to, move_from);
         placePiece<PieceType::pawn, enemy_color>(move_to + ep_offset);
     }
-    else if ( move.isPromotion() ) {
-        const Piece promotion_piece = move.getPromotionPiece<color>();
+    else if constexpr ( flag == Move::Flag::castle_k || flag == Move::Flag::castle_q ) {
+        constexpr bool king_side = (flag == Move::Flag::castle_k);
+        constexpr int rook_from = king_side ? (is_white ? 7 : 63) : (is_white ? 0 : 56);
+        constexpr int rook_to = king_side ? (is_white ? 5 : 61) : (is_white ? 3 : 59);
+
+        movePiece<PieceType::rook, my_color>(rook_to, rook_from);
+        movePiece<PieceType::king, my_color>(move_to, move_from);
+    }
+    else if constexpr ( flag_move.isPromotion() ) {
+        constexpr PieceType promotion_type = flag_move.getPromotionPieceType();
 
-        removePiece<my_color>(promotion_piece, move_to);
+        removePiece<promotion_type, my_color>(move_to);
         placePiece<PieceType::pawn, my_color>(move_from);
 
-        if ( move.isCapture() ) {
-            placePiece<enemy_color>(captured_piece, move_to);
+        if constexpr ( flag_move.isCapture() ) {
+            placePiece<enemy_color>(last_state.captured_piece, move_to);
         }
     }
-    else if ( move.isCapture() ) {
-        placePiece<enemy_color>(captured_piece, move_to);
-    }
 
-    state->zobrist_hash = last_state.zobrist_hash;
-}
\ No newline at end of file
+    // the piece operations already toggled their keys back, the stored hash also restores side, ep and castling keys
+    state.zobrist_hash = last_state.zobrist_hash;
+    move_history.pop();
+
+    updateAttackMap<color, flag>(move);
+
+    if ( accumulators ) {
+        accumulators->pop();
+    }
+}
@@ -0,0 +1,84 @@
+/**
+ * @file packed_position.h
+ * @brief   Fixed size binary position, 32 bytes, for datasets, caches and work queues.
+ *
+ * Layout:
+ *      occupancy       8 bytes     all occupied squares
+ *      pieces          16 bytes    one nibble (the Piece value) per occupied square, in ascending square order
+ *      flags           1 byte      bit 0: black to move, bits 1-4: raw castling rights (Q, K, q, k)
+ *      ep_square       1 byte      en passant target square, NO_EP if there is none
+ *      half_move       1 byte      50 move counter, at most 255
+ *      full_move       2 bytes     full move number, at most 65535
+ *
+ * A legal position has at most 32 pieces, so the nibbles always fit. Board::setFen refuses boards with more,
+ * Board::pack throws for them. setFen also refuses clocks that do not fit, pack saturates a clock that a game
+ * has played past them (a half move clock of 255 is still a draw). The struct is trivially copyable and can be written to files or pipes as is
+ * (the byte order is the one of the host), records read back from a file should be checked with isValid.
+ * See Board::pack and Board::unpack.
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+#include "definitions.h"
+
+struct PackedPosition {
+    static constexpr uint8_t NO_EP = 0xFF;
+    static constexpr int MAX_PIECES = 32;
+
+    uint64_t occupancy = 0ULL;
+    std::array<uint64_t, 2> pieces {};
+    uint8_t flags = 0;
+    uint8_t ep_square = NO_EP;
+    uint8_t half_move = 0;
+    uint8_t padding = 0;
+    uint16_t full_move = 1;
+    uint16_t reserved = 0;
+
+    constexpr bool operator==(const PackedPosition& other) const = default;
+
+    /**
+     * @brief   Whether the record can be decoded: at most MAX_PIECES pieces, a Piece value in every nibble,
+     *          one king per side and the en passant square on the board. Everything Board::pack writes is valid.
+     *
+     * @return true
+     */
+    constexpr bool isValid() const
+    {
+        const int count = std::popcount(occupancy);
+        if ( count > MAX_PIECES || (ep_square != NO_EP && ep_square >= 64) ) {
+            return false;
+        }
+
+        // all nibbles at once, the unused ones are masked to zero (a pawn, which neither check below counts)
+        constexpr uint64_t LOW_BITS = 0x1111111111111111ULL;
+        auto used = [](int nibbles) { return nibbles >= 16 ? ~0ULL : (1ULL << (nibbles * 4)) - 1; };
+        const std::array<uint64_t, 2> nibbles = { pieces[0] & used(count), pieces[1] & used(count > 16 ? count - 16 : 0) };
+
+        int white_kings = 0;
+        int black_kings = 0;
+        for ( const uint64_t word : nibbles ) {
+            // Piece::none and above have both high bits set
+            if ( (word >> 3) & (word >> 2) & LOW_BITS ) {
+                return false;
+            }
+
+            // a nibble equal to the king is zero after the xor
+            auto count_equal = [word](uint64_t piece) {
+                const uint64_t diff = word ^ (piece * LOW_BITS);
+                return std::popcount(~(diff | diff >> 1 | diff >> 2 | diff >> 3) & LOW_BITS);
+            };
+            white_kings += count_equal(static_cast<uint64_t>(Piece::K));
+            black_kings += count_equal(static_cast<uint64_t>(Piece::k));
+        }
+
+        return white_kings == 1 && black_kings == 1;
+    }
+};
+
+static_assert(sizeof(PackedPosition) == 32, "a packed position has to stay 32 bytes");
+static_assert(std::is_trivially_copyable_v<PackedPosition>, "packed positions are copied as raw bytes");
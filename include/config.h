@@ -3,6 +3,9 @@
 #define TODO            std::cerr << RED << "TODO: " << RESET
 #define STARTPOS        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 #define TTABLE_SIZE_MB  2
+#define EVAL_CACHE_SIZE_MB  1   // static eval cache, independent of the TT
+#define PAWN_TABLE_SIZE_MB  1   // pawn structure cache, one per searching thread
+#define MAX_PLY         128     // deepest ply the search can reach, sizes the per ply search data
 #define ENABLE_LOGGER   
 
 #define ENABLE_DEBUG    0
@@ -12,6 +15,34 @@
 #define SIMPLE_TEST     1
 #endif
 
+// use the vectorized move serializer (AVX-512 VBMI2 / AVX2, see move_generator/serialize.h)
+// off by default as the scalar version was faster in perft
+#ifndef SERIALIZE_SIMD
+#define SERIALIZE_SIMD  0
+#endif
+
+// keep per side attack maps in the board (see board/attack_map.h), can also be toggled per board at runtime
+#ifndef ENABLE_ATTACK_MAP
+#define ENABLE_ATTACK_MAP   0
+#endif
+
+// mobility, king zone attacks and pawn shelter in the static eval (see evalActivity in eval.h)
+#ifndef ENABLE_ACTIVITY_EVAL
+#define ENABLE_ACTIVITY_EVAL    1
+#endif
+
+// the search eval stops after the piece square score if that is this far outside the window (see evalPosition in eval.h)
+// a measured bound, not an exact one: the pawn and activity terms evaluated after it stayed within 88 cp over ~350k
+// perft positions, but the activity of both sides can add up to more. lowering it risks wrong cutoffs, 0 disables the lazy exit
+#ifndef LAZY_EVAL_MARGIN
+#define LAZY_EVAL_MARGIN    200
+#endif
+
+// reverse futility, futility pruning and razoring up to this remaining depth, the margins are UCI options (see PruningMargins in game.h)
+#ifndef PRUNING_DEPTH
+#define PRUNING_DEPTH       3
+#endif
+
 // PRINT STUFF
 #define COL_SPACING     18
 #define TABLE_WIDTH     (5 * COL_SPACING)
@@ -2,7 +2,9 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <array>
+#include <stdexcept>
 
 #define BIT_LOOP(X) for (; X != 0ULL ; X &= X - 1)
 
@@ -20,6 +22,18 @@ enum class Piece {
     none
 };
 
+// which subset of the pseudolegal moves a generator should produce
+// captures also contains quiet promotions, quiets also contains double pushes and castling
+// evasions are all moves, but non-king moves are restricted to a target mask and castling is skipped
+enum class GenType {
+    all, captures, quiets, evasions
+};
+
+// how generate_attacks gets the slider attacks: one magic lookup per piece, or set-wise Kogge-Stone fills
+enum class AttackKernel {
+    magic, kogge_stone
+};
+
 namespace utils {
     inline constexpr uint8_t isBishop(PieceType type) { return type == PieceType::bishop; }
     inline constexpr uint8_t isRook(PieceType type) { return type == PieceType::rook; }
@@ -97,7 +111,7 @@ namespace utils {
         "a8", "b8", "c8", "d8", "e8", "f8", "g8", "h8"
     } };
 
-    constexpr int coordinateToIndex(const std::string& str)
+    constexpr int coordinateToIndex(std::string_view str)
     {
         if ( str.length() != 2 ) {
             return 65;
@@ -1,205 +1,331 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <limits>
 
 #include "definitions.h"
+#include "config.h"
 #include "board/board.h"
 #include "move_generator/move_generation.h"
+#include "pawn_table.h"
+#include "psqt.h"
+#include "nnue/nnue.h"
 
 static constexpr double INFTY = std::numeric_limits<double>::infinity();
 
-constexpr std::array<int, 64> flipTable(const std::array<int, 64>& table)
+inline int getPawnScore(const Board& board)
 {
-    std::array<int, 64> flipped {};
-    for ( int i = 0; i < 64; ++i ) {
-        flipped[i] = table[63 - i];
+    const uint64_t white_pawns = board.getPieces<PieceType::pawn, Color::white>();
+    const uint64_t black_pawns = board.getPieces<PieceType::pawn, Color::black>();
+
+    int double_pawns = 0;
+    for ( uint64_t i = 0; i < 8; ++i ) {
+        const uint64_t file_mask = (FILE_A << i);
+
+        int w_pawns_in_file = get_bit_count(white_pawns & file_mask);
+        int b_pawns_in_file = get_bit_count(black_pawns & file_mask);
+
+        if ( w_pawns_in_file > 1 ) {
+            double_pawns += w_pawns_in_file;
+        }
+
+        if ( b_pawns_in_file > 1 ) {
+            double_pawns -= b_pawns_in_file;
+        }
     }
 
-    return flipped;
+    return -double_pawns;
 }
 
-static constexpr std::array<int, 64> pawn_position_score = {
-    0,  0,  0,  0,  0,  0,  0,  0,
-    50, 50, 50, 50, 50, 50, 50, 50,
-    10, 10, 20, 30, 30, 20, 10, 10,
-    5,  5, 10, 25, 25, 10,  5,  5,
-    0, 0,  0, 20, 20,  0,  0,  0,
-    5, -5,-10,  0,  0,-10, -5,  5,
-    5, 10, 10,-20,-20, 10, 10,  5,
-    0, 0, 0, 0, 0, 0, 0, 0
-};
+/**
+ * @brief   Everything the pawn table caches about the pawn structure of a position.
+ *
+ * @param board
+ * @return PawnEntry    the entry, with the pawn key of the board
+ */
+inline PawnEntry evalPawnStructure(const Board& board)
+{
+    const uint64_t white_pawns = board.getPieces<PieceType::pawn, Color::white>();
+    const uint64_t black_pawns = board.getPieces<PieceType::pawn, Color::black>();
 
-static constexpr std::array<int, 64> knight_position_score = {
-    -50,-40,-30,-30,-30,-30,-40,-50,
-    -40,-20,  0,  0,  0,  0,-20,-40,
-    -30,  0, 10, 15, 15, 10,  0,-30,
-    -30,  5, 15, 20, 20, 15,  5,-30,
-    -30,  0, 15, 20, 20, 15,  0,-30,
-    -30,  5, 10, 15, 15, 10,  5,-30,
-    -40,-20,  0,  5,  5,  0,-20,-40,
-    -50,-40,-30,-30,-30,-30,-40,-50,
-};
+    // squares in front of the pawns, towards the promotion rank
+    auto frontSpanWhite = [](uint64_t b) { b |= b << 8; b |= b << 16; b |= b << 32; return b << 8; };
+    auto frontSpanBlack = [](uint64_t b) { b |= b >> 8; b |= b >> 16; b |= b >> 32; return b >> 8; };
 
-static constexpr std::array<int, 64> bishop_position_score = {
-    -20,-10,-10,-10,-10,-10,-10,-20,
-    -10,  0,  0,  0,  0,  0,  0,-10,
-    -10,  0,  5, 10, 10,  5,  0,-10,
-    -10,  5,  5, 10, 10,  5,  5,-10,
-    -10,  0, 10, 10, 10, 10,  0,-10,
-    -10, 10, 10, 10, 10, 10, 10,-10,
-    -10,  5,  0,  0,  0,  0,  5,-10,
-    -20,-10,-10,-10,-10,-10,-10,-20,
-};
+    // a pawn is passed if no enemy pawn is in front of it on its own or a neighbouring file
+    uint64_t black_spans = frontSpanBlack(black_pawns);
+    black_spans |= east(black_spans) | west(black_spans);
+    uint64_t white_spans = frontSpanWhite(white_pawns);
+    white_spans |= east(white_spans) | west(white_spans);
 
-static constexpr std::array<int, 64> rook_position_score = {
-    0,  0,  0,  0,  0,  0,  0,  0,
-    5, 10, 10, 10, 10, 10, 10,  5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    -5,  0,  0,  0,  0,  0,  0, -5,
-    0,  0,  0,  5,  5,  0,  0,  0
-};
+    // all files with a pawn, projected onto the first rank
+    auto files = [](uint64_t b) { b |= b >> 8; b |= b >> 16; b |= b >> 32; return static_cast<uint8_t>(b & 0xFF); };
 
-static constexpr std::array<int, 64> queen_position_score = {
-    -20,-10,-10, -5, -5,-10,-10,-20,
-    -10,  0,  0,  0,  0,  0,  0,-10,
-    -10,  0,  5,  5,  5,  5,  0,-10,
-    -5,  0,  5,  5,  5,  5,  0, -5,
-    0,  0,  5,  5,  5,  5,  0, -5,
-    -10,  5,  5,  5,  5,  5,  0,-10,
-    -10,  0,  5,  0,  0,  0,  0,-10,
-    -20,-10,-10, -5, -5,-10,-10,-20
-};
+    PawnEntry entry;
+    entry.key = board.getPawnKey();
+    entry.passed = { white_pawns & ~black_spans, black_pawns & ~white_spans };
+    entry.semi_open_files = { static_cast<uint8_t>(~files(white_pawns)), static_cast<uint8_t>(~files(black_pawns)) };
+    entry.score = static_cast<int16_t>(getPawnScore(board));
 
-// early game
-static constexpr std::array<int, 64> king_position_score = {
-    -30,-40,-40,-50,-50,-40,-40,-30,
-    -30,-40,-40,-50,-50,-40,-40,-30,
-    -30,-40,-40,-50,-50,-40,-40,-30,
-    -30,-40,-40,-50,-50,-40,-40,-30,
-    -20,-30,-30,-40,-40,-30,-30,-20,
-    -10,-20,-20,-20,-20,-20,-20,-10,
-    20, 20,  0,  0,  0,  0, 20, 20,
-    20, 30, 10,  0,  0, 10, 30, 20
-};
+    return entry;
+}
 
-template <PieceType type, Color color>
-const std::array<int, 64> getPositionBoard()
+/**
+ * @brief   The pawn structure of a position, from the pawn table if it is there.
+ *
+ * @param board
+ * @param pawn_table    table of the searching thread
+ * @return const PawnEntry&
+ */
+template <size_t MB>
+inline const PawnEntry& probePawnStructure(const Board& board, PawnTable<MB>& pawn_table)
 {
-    if constexpr ( utils::isWhite(color) ) {
-        switch ( type ) {
-            case PieceType::pawn: return pawn_position_score;
-            case PieceType::knight: return knight_position_score;
-            case PieceType::bishop: return bishop_position_score;
-            case PieceType::rook: return rook_position_score;
-            case PieceType::queen: return queen_position_score;
-            case PieceType::king: return king_position_score;
-            default: return {};
-        }
+    PawnEntry& entry = pawn_table[board.getPawnKey()];
+    if ( entry.key != board.getPawnKey() ) {
+        entry = evalPawnStructure(board);
     }
-    else {
-        switch ( type ) {
-            case PieceType::pawn: return flipTable(pawn_position_score);
-            case PieceType::knight: return flipTable(knight_position_score);
-            case PieceType::bishop: return flipTable(bishop_position_score);
-            case PieceType::rook: return flipTable(rook_position_score);
-            case PieceType::queen: return flipTable(queen_position_score);
-            case PieceType::king: return flipTable(king_position_score);
-            default: return {};
-        }
-    }
-}
 
-template <PieceType type>
-inline int getPieceScore(const Board& board, int value)
-{
-    const uint64_t white_pieces = board.getPieces<type, Color::white>();
-    const uint64_t black_pieces = board.getPieces<type, Color::black>();
-    return (get_bit_count(white_pieces) - get_bit_count(black_pieces)) * value;
+    return entry;
 }
 
-inline int getMaterialScore(const Board& board)
+// per safe square (not occupied by an own piece, not attacked by an enemy pawn) that the pieces of a type reach,
+// by piece type knight to queen. centered on a typical count per piece, so an average piece is still worth its material
+constexpr std::array<Score, 4> mobility_weight = { S(4, 4), S(5, 5), S(2, 4), S(1, 2) };
+constexpr std::array<int, 4> mobility_center = { 4, 6, 6, 12 };
+
+// per attacked square of the enemy king zone, by piece type knight to queen
+constexpr std::array<int, 4> king_attack_weight = { 2, 2, 3, 5 };
+// in percent of the attack weight, by the number of piece types attacking the zone. a lone attacker is rarely dangerous
+constexpr std::array<int, 5> king_attackers_scale = { 0, 0, 50, 75, 88 };
+
+// own pawns in front of the king and on the neighbouring files, one and two ranks ahead
+constexpr Score SHELTER_NEAR = S(12, 0);
+constexpr Score SHELTER_FAR = S(6, 0);
+
+/**
+ * @brief   Attacks of the knights, bishops, rooks and queens of both sides, by color and piece type knight to queen.
+ *          Set-wise with the leaper masks and Kogge-Stone fills of the move generator, so there is no loop over
+ *          the pieces and no magic table to miss in the cache. The sliders of both colors are filled together (attacks4).
+ *
+ * @tparam Position     Board, or anything with the same getPieces<type, color>()
+ * @param position
+ * @param occupancy
+ * @return std::array<std::array<u64, 4>, 2>   [color][type]
+ */
+template <typename Position>
+inline std::array<std::array<u64, 4>, 2> pieceTypeAttacks(const Position& position, u64 occupancy)
 {
-    const int pawn_score = getPieceScore<PieceType::pawn>(board, 100);
-    const int knight_score = getPieceScore<PieceType::knight>(board, 320);
-    const int bishop_score = getPieceScore<PieceType::bishop>(board, 320);
-    const int rook_score = getPieceScore<PieceType::rook>(board, 500);
-    const int queen_score = getPieceScore<PieceType::queen>(board, 900);
-    const int king_score = getPieceScore<PieceType::king>(board, 10000);
-
-    return pawn_score + knight_score + bishop_score + rook_score + queen_score + king_score;
+    const u64 white_queens = position.template getPieces<PieceType::queen, Color::white>();
+    const u64 black_queens = position.template getPieces<PieceType::queen, Color::black>();
+
+    const auto diagonal = kogge_stone::attacks4<true>({
+        position.template getPieces<PieceType::bishop, Color::white>(), white_queens,
+        position.template getPieces<PieceType::bishop, Color::black>(), black_queens }, occupancy);
+    const auto orthogonal = kogge_stone::attacks4<false>({
+        position.template getPieces<PieceType::rook, Color::white>(), white_queens,
+        position.template getPieces<PieceType::rook, Color::black>(), black_queens }, occupancy);
+
+    return { {
+        { leapers::getKnightAttackMask(position.template getPieces<PieceType::knight, Color::white>()),
+            diagonal[0], orthogonal[0], diagonal[1] | orthogonal[1] },
+        { leapers::getKnightAttackMask(position.template getPieces<PieceType::knight, Color::black>()),
+            diagonal[2], orthogonal[2], diagonal[3] | orthogonal[3] },
+    } };
 }
 
-inline int getPawnScore(const Board& board)
+/**
+ * @brief   Mobility, attacks on the enemy king zone and the pawn shelter of one side.
+ *
+ * @tparam color
+ * @tparam Position     Board, or anything with the same getPieces<type, color>()
+ * @param position
+ * @param attacks       the attacks of color by piece type, see pieceTypeAttacks
+ * @return Score        good for color is positive
+ */
+template <Color color, typename Position>
+inline Score evalActivity(const Position& position, const std::array<u64, 4>& attacks)
 {
-    const uint64_t white_pawns = board.getPieces<PieceType::pawn, Color::white>();
-    const uint64_t black_pawns = board.getPieces<PieceType::pawn, Color::black>();
+    constexpr Color enemy = utils::switchColor(color);
 
-    int double_pawns = 0;
-    for ( uint64_t i = 0; i < 8; ++i ) {
-        const uint64_t file_mask = (FILE_A << i);
+    const std::array<u64, 4> pieces = {
+        position.template getPieces<PieceType::knight, color>(), position.template getPieces<PieceType::bishop, color>(),
+        position.template getPieces<PieceType::rook, color>(), position.template getPieces<PieceType::queen, color>()
+    };
+    const u64 own_pawns = position.template getPieces<PieceType::pawn, color>();
+    const u64 own_king = position.template getPieces<PieceType::king, color>();
+    const u64 own = own_pawns | own_king | pieces[0] | pieces[1] | pieces[2] | pieces[3];
 
-        int w_pawns_in_file = get_bit_count(white_pawns & file_mask);
-        int b_pawns_in_file = get_bit_count(black_pawns & file_mask);
+    const u64 safe = ~own & ~leapers::getPawnAttackMask<enemy>(position.template getPieces<PieceType::pawn, enemy>());
 
-        if ( w_pawns_in_file > 1 ) {
-            double_pawns += w_pawns_in_file;
-        }
+    const u64 enemy_king = position.template getPieces<PieceType::king, enemy>();
+    const u64 king_zone = enemy_king | king_attacks[get_LSB(enemy_king)];
 
-        if ( b_pawns_in_file > 1 ) {
-            double_pawns -= b_pawns_in_file;
-        }
+    Score score = 0;
+    int attackers = 0;
+    int attack_weight = 0;
+
+    for ( int i = 0; i < 4; ++i ) {
+        score += mobility_weight[i] * (get_bit_count(attacks[i] & safe) - mobility_center[i] * get_bit_count(pieces[i]));
+
+        const int zone_attacks = get_bit_count(attacks[i] & king_zone);
+        attackers += zone_attacks != 0;
+        attack_weight += king_attack_weight[i] * zone_attacks;
     }
 
-    return -double_pawns;
+    score += S(attack_weight * king_attackers_scale[attackers] / 100, 0);
+
+    const u64 king_files = own_king | east(own_king) | west(own_king);
+    const u64 shelter_near = utils::isWhite(color) ? north(king_files) : south(king_files);
+    const u64 shelter_far = utils::isWhite(color) ? north(shelter_near) : south(shelter_near);
+    score += SHELTER_NEAR * get_bit_count(own_pawns & shelter_near) + SHELTER_FAR * get_bit_count(own_pawns & shelter_far);
+
+    return score;
 }
 
-template <PieceType type, Color color>
-inline int getPiecePositionScore(const Board& board)
+/**
+ * @brief   Mobility, king safety and pawn shelter of both sides, white positive. 0 if ENABLE_ACTIVITY_EVAL is off.
+ *
+ * @tparam Position
+ * @param position
+ * @return Score
+ */
+template <typename Position>
+inline Score evalActivity(const Position& position)
 {
-    const auto score_table = getPositionBoard<type, color>();
-
-    int result = 0;
-    uint64_t pieces = board.getPieces<type, color>();
-    BIT_LOOP(pieces)
-    {
-        const int square = get_LSB(pieces);
-        result += score_table[square];
+    if constexpr ( ENABLE_ACTIVITY_EVAL ) {
+        const auto attacks = pieceTypeAttacks(position, position.getOccupancy());
+        return evalActivity<Color::white>(position, attacks[0]) - evalActivity<Color::black>(position, attacks[1]);
     }
+    else {
+        return 0;
+    }
+}
 
-    return utils::isWhite(color) ? result : -result;
+/**
+ * @brief   Interpolate between the midgame and the endgame value.
+ *
+ * @param score
+ * @param phase     0 (endgame) to psqt::MAX_PHASE (midgame)
+ * @return int
+ */
+constexpr int taper(Score score, int phase)
+{
+    return (mg_value(score) * phase + eg_value(score) * (psqt::MAX_PHASE - phase)) / psqt::MAX_PHASE;
 }
 
+/**
+ * @brief   Static eval: the incremental piece square score of the board and the activity of the pieces,
+ *          tapered by the game phase, plus the pawn structure.
+ *
+ * @tparam color    side to move, the score is relative to it
+ * @param board
+ * @param pawn_score    pawn structure score from white's view
+ * @return double
+ */
 template <Color color>
-inline int getPositionalScore(const Board& board)
+inline double evalPosition(const Board& board, int pawn_score)
 {
-    int result = 0;
-
-    result += getPiecePositionScore<PieceType::pawn, color>(board);
-    result += getPiecePositionScore<PieceType::knight, color>(board);
-    result += getPiecePositionScore<PieceType::bishop, color>(board);
-    result += getPiecePositionScore<PieceType::rook, color>(board);
-    result += getPiecePositionScore<PieceType::queen, color>(board);
-    result += getPiecePositionScore<PieceType::king, color>(board);
+    // promotions can push the phase above the maximum
+    const int phase = std::min(board.getPhase(), psqt::MAX_PHASE);
+    const double score = taper(board.getPsqt() + evalActivity(board), phase) + pawn_score;
 
-    return result;
+    if constexpr ( utils::isWhite(color) ) {
+        return score;
+    }
+    else {
+        return -score;
+    }
 }
 
 template <Color color>
 inline double evalPosition(Board& board)
 {
-    const int material_score = getMaterialScore(board);
-    const int position_score = getPositionalScore<color>(board);
-    const int pawn_scores = getPawnScore(board);
+    return evalPosition<color>(board, getPawnScore(board));
+}
 
-    const double score = material_score + position_score + pawn_scores;
+/**
+ * @brief   Lazy exits of the search eval and an estimate of the time they saved.
+ *          Timing every eval would cost about as much as the stages themselves,
+ *          so only every TIMING_INTERVAL-th full eval is timed. NNUE evals count as full ones and are not timed.
+ */
+struct EvalStats {
+    static constexpr uint64_t TIMING_INTERVAL = 64;
 
-    if constexpr ( utils::isWhite(color) ) {
-        return score;
+    uint64_t full = 0;
+    uint64_t lazy = 0;
+
+    uint64_t timed = 0;
+    std::chrono::nanoseconds timed_duration { 0 };
+
+    /**
+     * @brief   The lazy exits times the average measured cost of a full eval (the first stage they did run is a few adds).
+     *
+     * @return double   milliseconds
+     */
+    inline double savedMilliseconds() const
+    {
+        if ( timed == 0 ) {
+            return 0.0;
+        }
+
+        return static_cast<double>(lazy) * timed_duration.count() / timed / 1e6;
     }
-    else {
-        return -score;
+};
+
+// result of the staged search eval, a lazy exit is only a bound for the window it was computed with
+struct StagedEval {
+    double score;
+    bool exact;
+};
+
+/**
+ * @brief   Static eval for the search: the network if the board keeps NNUE accumulators. Otherwise staged,
+ *          the incremental piece square score first, and the pawn structure and the activity only if that
+ *          is within LAZY_EVAL_MARGIN of the window. A lazy exit returns the bound the margin guarantees.
+ *
+ * @tparam color    side to move, the score and the window are relative to it
+ * @param board
+ * @param pawn_table
+ * @param alpha
+ * @param beta
+ * @param stats
+ * @return StagedEval
+ */
+template <Color color, size_t MB>
+inline StagedEval evalPosition(Board& board, PawnTable<MB>& pawn_table, double alpha, double beta, EvalStats& stats)
+{
+    // the network has no stages to skip, every eval is a full one
+    if ( board.hasNnue() ) {
+        ++stats.full;
+        return { static_cast<double>(nnue::evaluate<color>(board)), true };
+    }
+
+    if constexpr ( LAZY_EVAL_MARGIN > 0 ) {
+        const int phase = std::min(board.getPhase(), psqt::MAX_PHASE);
+        const double lazy_score = utils::isWhite(color) ? taper(board.getPsqt(), phase) : -taper(board.getPsqt(), phase);
+
+        if ( lazy_score - LAZY_EVAL_MARGIN >= beta ) {
+            ++stats.lazy;
+            return { lazy_score - LAZY_EVAL_MARGIN, false };
+        }
+
+        if ( lazy_score + LAZY_EVAL_MARGIN <= alpha ) {
+            ++stats.lazy;
+            return { lazy_score + LAZY_EVAL_MARGIN, false };
+        }
+    }
+
+    ++stats.full;
+    if ( stats.full % EvalStats::TIMING_INTERVAL != 0 ) {
+        return { evalPosition<color>(board, probePawnStructure(board, pawn_table).score), true };
     }
+
+    const auto start = std::chrono::steady_clock::now();
+    const double score = evalPosition<color>(board, probePawnStructure(board, pawn_table).score);
+    stats.timed_duration += std::chrono::steady_clock::now() - start;
+    ++stats.timed;
+
+    return { score, true };
 }
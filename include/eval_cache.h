@@ -0,0 +1,73 @@
+/**
+ * @file eval_cache.h
+ * @brief   Cache of static evaluations, keyed by the Zobrist key.
+ *
+ * An entry is a single 64 bit word: the upper 48 bits of the key and a 16 bit score.
+ * Reads and writes are one relaxed atomic load / store, so threads can share a cache without locks
+ * and never see a torn entry. A lost race only costs a recomputation.
+ *
+ * The score is relative to the side to move, the key already contains the side to move.
+ * The cache is sized on its own (EVAL_CACHE_SIZE_MB), it does not compete with the TT for memory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+template <size_t MB>
+class EvalCache {
+    // a power of two, so the index is a mask of the low bits
+    static constexpr size_t _size = std::bit_floor((MB * 1024 * 1024) / sizeof(uint64_t));
+    static constexpr uint64_t KEY_MASK = ~0xFFFFULL;
+
+    std::vector<std::atomic<uint64_t>> table;
+public:
+    EvalCache() : table(_size) { }
+
+    /**
+     * @brief   Look up the static eval of a position.
+     *
+     * @param key       zobrist key of the position
+     * @param score     set to the cached score on a hit
+     * @return true     on a hit
+     */
+    inline bool probe(uint64_t key, int& score) const
+    {
+        const uint64_t entry = table[key & (_size - 1)].load(std::memory_order_relaxed);
+        if ( (entry ^ key) & KEY_MASK ) {
+            return false;
+        }
+
+        score = static_cast<int16_t>(entry & 0xFFFF);
+        return true;
+    }
+
+    /**
+     * @brief   Store the static eval of a position, always replaces. Scores that do not fit in 16 bits are not stored.
+     *
+     * @param key       zobrist key of the position
+     * @param score     static eval relative to the side to move
+     */
+    inline void store(uint64_t key, int score)
+    {
+        if ( score < std::numeric_limits<int16_t>::min() || score > std::numeric_limits<int16_t>::max() ) {
+            return;
+        }
+
+        const uint64_t entry = (key & KEY_MASK) | static_cast<uint16_t>(score);
+        table[key & (_size - 1)].store(entry, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for ( auto& entry : table ) {
+            entry.store(0ULL, std::memory_order_relaxed);
+        }
+    }
+
+    constexpr size_t size() const { return _size; }
+};
@@ -8,21 +8,61 @@
 #include "board/board.h"
 #include "move.h"
 #include "move_generator/move_generation.h"
+#include "move_generator/move_picker.h"
+#include "search_stack.h"
 #include "ttable.h"
+#include "perft_table.h"
+#include "quiescence.h"
+#include "eval_cache.h"
 #include "eval.h"
 #include "config.h"
 
+/**
+ * @brief   Counters of the last bestMove call.
+ */
+struct SearchStats {
+    uint64_t nodes = 0;
+    EvalStats eval;
+
+    // nodes cut by reverse futility and razoring, quiet moves skipped by futility pruning
+    uint64_t reverse_futility = 0;
+    uint64_t razoring = 0;
+    uint64_t futility = 0;
+};
+
+/**
+ * @brief   Margins of the shallow depth pruning in minimax, in centipawns per ply of remaining depth.
+ *          Global, so the values set with setoption survive the new Game of every position command.
+ */
+struct PruningMargins {
+    // the static eval is this far above beta, prune the node
+    int reverse_futility = 100;
+    // the static eval is this far below alpha, prune the node if the captures do not get back to alpha either
+    int razoring = 250;
+    // the static eval is this far below alpha, skip the quiet moves
+    int futility = 120;
+};
+
+extern PruningMargins pruning_margins;
+
 class Game {
 private:
     Board board;
-    TTable<TTEntry_perft, TTABLE_SIZE_MB> tt_perft;
+    PerftTable<TTABLE_SIZE_MB> tt_perft;
     TTable<TTEntry_eval, TTABLE_SIZE_MB> tt_eval;
+    EvalCache<EVAL_CACHE_SIZE_MB> eval_cache;
+    PawnTable<PAWN_TABLE_SIZE_MB> pawn_table;
+
+    // per ply move buffers, killers and pv, a Game is only ever searched by one thread
+    SearchStack search_stack;
+
+    SearchStats stats;
 
 public:
     Game()
     {
         board = Board();
-        tt_perft = TTable<TTEntry_perft, TTABLE_SIZE_MB>();
+        board.setNnue(nnue::network.isLoaded());
     }
 
     Game(const std::string& fen);
@@ -35,8 +75,26 @@ public:
     uint64_t perftSimpleEntry(int depth);
     uint64_t perftDetailEntry(int depth);
 
+    /**
+     * @brief   Keep the perft table in a file between runs, see PerftFile. Throws a runtime_error if it can not be mapped.
+     *
+     * @param path
+     * @param fingerprint   of the running binary
+     * @return true         if the file already had node counts of this binary
+     */
+    bool usePerftCache(const std::string& path, uint64_t fingerprint) { return tt_perft.mapFile(path, fingerprint); }
+
     std::string toString() const { return board.toString(); }
 
+    /**
+     * @brief   The principal variation of the last bestMove call in long algebraic notation.
+     *
+     * @return std::string  moves separated by spaces
+     */
+    std::string getPrincipalVariation() const;
+
+    const SearchStats& getStats() const { return stats; }
+
     template <Color color>
     Move getBestMove(Board& board, int depth = 5);
 
@@ -51,7 +109,16 @@ private:
     uint64_t debug_perft(Board& board, int depth);
 
     template <Color color>
-    double minimax(Board& board, int depth, double alpha, double beta);
+    double minimax(Board& board, int depth, int ply, double alpha, double beta);
+
+    template <Color color>
+    double quiesce(Board& board, int ply, double alpha, double beta);
+
+    template <Color color>
+    double staticEval(Board& board, uint64_t key);
+
+    Move getHashMove(uint64_t key);
+    void storeKiller(int ply, const Move& move);
 };
 
 template <Color color, bool print_moves>
@@ -59,11 +126,13 @@ uint64_t Game::perft(Board& board, int depth)
 {
     uint64_t nodes = 0ULL;
     uint64_t key = board.getZobristKey();
-    if ( tt_perft.if_has_get(key, depth, nodes) ) {
+    if ( tt_perft.probe(key, depth, nodes) ) {
         return nodes;
     }
 
-    MoveList list;
+    assert(depth <= MAX_PLY && "perft depth exceeds the search stack");
+    MoveList& list = search_stack[depth].moves;
+    list.clear();
 
     generate_moves<color>(list, board);
     if ( depth == 1 ) {
@@ -83,7 +152,7 @@ uint64_t Game::perft(Board& board, int depth)
         board.undo<color>(move);
     }
 
-    tt_perft.emplace(key, nodes, depth);
+    tt_perft.store(key, depth, nodes);
     return nodes;
 }
 
@@ -92,11 +161,17 @@ uint64_t Game::debug_perft(Board& board, int depth)
 {
     uint64_t nodes = 0ULL;
     uint64_t key = board.getZobristKey();
-    if ( tt_perft.if_has_get(key, depth, nodes) ) {
-        return nodes;
+
+    // a hit would skip the counts per move, perftree needs them even if the total is known
+    if constexpr ( !print_moves ) {
+        if ( tt_perft.probe(key, depth, nodes) ) {
+            return nodes;
+        }
     }
 
-    MoveList list;
+    assert(depth <= MAX_PLY && "perft depth exceeds the search stack");
+    MoveList& list = search_stack[depth].moves;
+    list.clear();
 
     generate_moves<color>(list, board);
     if ( depth == 0 ) {
@@ -116,39 +191,47 @@ uint64_t Game::debug_perft(Board& board, int depth)
         board.undo<color>(move);
     }
 
-    tt_perft.emplace(key, nodes, depth);
+    tt_perft.store(key, depth, nodes);
     return nodes;
 }
 
 template <Color color>
 Move Game::getBestMove(Board& board, int depth)
 {
+    SearchFrame& root = search_stack[0];
+    root.pv_length = 0;
+
     uint64_t key = board.getZobristKey();
     if ( tt_eval.has(key, depth) ) {
         auto entry = tt_eval.get(key);
         if ( entry.type == TTEntry_eval::EXACT ) {
+            root.pv[0] = entry.best_move;
+            root.pv_length = 1;
             return entry.best_move;
         }
     }
 
-    MoveList move_list;
-    generate_moves<color>(move_list, board);
-
-    assert(move_list.size() != 0 && "no moves to generate! in getBestMove()");
+    MovePicker<color> picker(board, getHashMove(key), root);
 
-    Move best_move;
+    Move best_move = Move();
     double best_score = -INFTY;  // negamax, so we initialize to -INFTY
     double alpha = -INFTY;
     double beta = INFTY;
 
-    for ( const auto& move : move_list ) {
+    for ( Move move = picker.next(); move != Move(); move = picker.next() ) {
+        if ( !board.isLegal<color>(move) ) {
+            continue;
+        }
+
         board.move<color>(move);
-        double score = -minimax<utils::switchColor(color)>(board, depth - 1, -beta, -alpha);
+        double score = -minimax<utils::switchColor(color)>(board, depth - 1, 1, -beta, -alpha);
         board.undo<color>(move);
 
-        if ( score > best_score ) {
+        // the first legal move is taken even if every move gets mated
+        if ( score > best_score || best_move == Move() ) {
             best_score = score;
             best_move = move;
+            search_stack.updatePv(0, move);
         }
 
         alpha = std::max(alpha, score);
@@ -157,55 +240,130 @@ Move Game::getBestMove(Board& board, int depth)
         }
     }
 
+    assert(best_move != Move() && "no moves to generate! in getBestMove()");
+
     tt_eval.emplace(key, depth, best_score, best_move, TTEntry_eval::EXACT);
 
-    assert(best_move != Move() && "wtf!");
     return best_move;
 }
 
 template <Color color>
-double Game::minimax(Board& board, int depth, double alpha, double beta)
+double Game::minimax(Board& board, int depth, int ply, double alpha, double beta)
 {
+    SearchFrame& frame = search_stack[ply];
+    frame.pv_length = 0;
+    ++stats.nodes;
+
+    // before the TT, a stored score does not know how we got here
+    if ( board.isDraw() ) {
+        return 0.0;
+    }
+
     uint64_t key = board.getZobristKey();
     if ( tt_eval.has(key, depth) ) {
         auto entry = tt_eval.get(key);
         return entry.best_score;
     }
 
-    if ( depth == 0 ) {
-        return evalPosition<color>(board);
-    }
-
-    MoveList move_list;
-    generate_moves<color>(move_list, board);
-
-    // no moves -> checkmate or stalemate
-    if ( move_list.size() == 0 ) {
-        const uint64_t enemy_attacks = generate_attacks<utils::switchColor(color)>(board);
-        if ( board.isCheck<color>(enemy_attacks) ) {
-            return (utils::isWhite(color)) ? INFTY : -INFTY;
+    if ( depth == 0 || ply >= MAX_PLY ) {
+        int cached_eval;
+        if ( eval_cache.probe(key, cached_eval) ) {
+            frame.static_eval = cached_eval;
         }
         else {
-            return 0;
+            const StagedEval eval = evalPosition<color>(board, pawn_table, alpha, beta, stats.eval);
+            frame.static_eval = eval.score;
+
+            // a lazy exit is a bound for this window only, another window may need the exact score
+            if ( eval.exact ) {
+                eval_cache.store(key, static_cast<int>(frame.static_eval));
+            }
+        }
+
+        return frame.static_eval;
+    }
+
+    // shallow depth pruning on the static eval, not in check where the eval says little about the position.
+    // before the picker is constructed, razoring searches the captures with the move buffer of this ply
+    bool futile = false;
+    if ( depth <= PRUNING_DEPTH ) {
+        const u64 king = board.getPieces<PieceType::king, color>();
+        const bool in_check = attackers_to<utils::switchColor(color)>(board, get_LSB(king), board.getOccupancy()) != 0ULL;
+
+        if ( !in_check ) {
+            frame.static_eval = staticEval<color>(board, key);
+
+            if ( frame.static_eval - pruning_margins.reverse_futility * depth >= beta ) {
+                ++stats.reverse_futility;
+                return frame.static_eval;
+            }
+
+            if ( frame.static_eval + pruning_margins.razoring * depth <= alpha ) {
+                const double score = quiesce<color>(board, ply, alpha, beta);
+                if ( score <= alpha ) {
+                    ++stats.razoring;
+                    return score;
+                }
+            }
+
+            futile = frame.static_eval + pruning_margins.futility * depth <= alpha;
         }
     }
 
+    MovePicker<color> picker(board, getHashMove(key), frame);
+
+    int legal_moves = 0;
+    Move best_move = Move();
     double best_score = -INFTY;  // negamax, so we initialize to -INFTY
-    for ( const auto& move : move_list ) {
+    for ( Move move = picker.next(); move != Move(); move = picker.next() ) {
+        if ( !board.isLegal<color>(move) ) {
+            continue;
+        }
+
+        ++legal_moves;
         board.move<color>(move);
-        double score = -minimax<utils::switchColor(color)>(board, depth - 1, -beta, -alpha);
+
+        // a quiet move would have to gain more than the margin to reach alpha. the first legal move is always
+        // searched, so the node still has a score and is not mistaken for a mate or stalemate. checks are searched
+        // too, the static eval knows nothing about what they threaten
+        if ( futile && legal_moves > 1 && !move.isCapture() && !move.isPromotion() ) {
+            const u64 enemy_king = board.getPieces<PieceType::king, utils::switchColor(color)>();
+            if ( attackers_to<color>(board, get_LSB(enemy_king), board.getOccupancy()) == 0ULL ) {
+                board.undo<color>(move);
+                ++stats.futility;
+                continue;
+            }
+        }
+
+        double score = -minimax<utils::switchColor(color)>(board, depth - 1, ply + 1, -beta, -alpha);
         board.undo<color>(move);
 
         if ( score > best_score ) {
             best_score = score;
+            best_move = move;
+            search_stack.updatePv(ply, move);
         }
 
         alpha = std::max(alpha, score);
         if ( alpha >= beta ) {
+            if ( !move.isCapture() && !move.isPromotion() ) {
+                storeKiller(ply, move);
+            }
+
             break;  // Alpha-beta pruning
         }
     }
 
+    // no moves -> checkmate or stalemate
+    if ( legal_moves == 0 ) {
+        if ( picker.inCheck() ) {
+            return -INFTY;  // the side to move is mated
+        }
+        else {
+            return 0;
+        }
+    }
+
     auto type = TTEntry_eval::EXACT;
     if ( best_score <= alpha ) {
         type = TTEntry_eval::UPPERBOUND;
@@ -214,7 +372,50 @@ double Game::minimax(Board& board, int depth, double alpha, double beta)
         type = TTEntry_eval::LOWERBOUND;
     }
 
-    tt_eval.emplace(key, depth, best_score, Move(), type);
+    tt_eval.emplace(key, depth, best_score, best_move, type);
 
     return best_score;
 }
+
+/**
+ * @brief   The quiescence search of razoring (see quiescence.h) on the staged eval of this game.
+ *
+ * @tparam color
+ * @param board
+ * @param ply
+ * @param alpha
+ * @param beta
+ * @return double   fail hard, within [alpha, beta]
+ */
+template <Color color>
+double Game::quiesce(Board& board, int ply, double alpha, double beta)
+{
+    auto eval = [this]<Color side>(Board& position, double low, double high) {
+        ++stats.nodes;
+        return evalPosition<side>(position, pawn_table, low, high, stats.eval).score;
+    };
+
+    return quiescence<color>(board, search_stack, ply, MAX_PLY, alpha, beta, eval);
+}
+
+/**
+ * @brief   The exact static eval of an inner node, through the eval cache.
+ *
+ * @tparam color
+ * @param board
+ * @param key
+ * @return double
+ */
+template <Color color>
+double Game::staticEval(Board& board, uint64_t key)
+{
+    int cached_eval;
+    if ( eval_cache.probe(key, cached_eval) ) {
+        return cached_eval;
+    }
+
+    // an infinite window never exits lazily
+    const double eval = evalPosition<color>(board, pawn_table, -INFTY, INFTY, stats.eval).score;
+    eval_cache.store(key, static_cast<int>(eval));
+    return eval;
+}
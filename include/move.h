@@ -40,7 +40,8 @@ private:
     static constexpr uint16_t RAW_PROMO_MASK = (0b1000 << FLAG_SHIFT);
 
 public:
-    constexpr Move() : raw(0x0000) { }
+    // trivial, so move buffers can stay uninitialized. Move() still value initializes to the null move
+    Move() = default;
     explicit constexpr Move(uint16_t raw) : raw(raw) { }
 
     constexpr Move(uint8_t from, uint8_t to, Flag flag)
@@ -55,6 +56,16 @@ public:
         return Move((static_cast<uint16_t>(flag) << FLAG_SHIFT) | (from << FROM_SHIFT) | (to << TO_SHIFT));
     }
 
+    /**
+     * @brief   Turns a runtime flag into a template argument, calls func.template operator()<flag>().
+     *          Unused flags (0b0110, 0b0111) call nothing.
+     *
+     * @param flag      the runtime flag
+     * @param func      a lambda templated on the flag, []<Move::Flag flag>() { ... }
+     */
+    template <typename Func>
+    static constexpr void dispatch(Flag flag, Func&& func);
+
     constexpr bool operator==(const Move& other) const { return raw == other.raw; }
     constexpr bool operator!=(const Move& other) const { return raw != other.raw; }
 
@@ -129,6 +140,28 @@ constexpr Piece Move::getPromotionPiece() const
     }
 }
 
+template <typename Func>
+constexpr void Move::dispatch(Flag flag, Func&& func)
+{
+    switch ( flag ) {
+        case Flag::quiet: func.template operator()<Flag::quiet>(); break;
+        case Flag::pawn_push: func.template operator()<Flag::pawn_push>(); break;
+        case Flag::castle_k: func.template operator()<Flag::castle_k>(); break;
+        case Flag::castle_q: func.template operator()<Flag::castle_q>(); break;
+        case Flag::capture: func.template operator()<Flag::capture>(); break;
+        case Flag::ep: func.template operator()<Flag::ep>(); break;
+        case Flag::promo_n: func.template operator()<Flag::promo_n>(); break;
+        case Flag::promo_b: func.template operator()<Flag::promo_b>(); break;
+        case Flag::promo_r: func.template operator()<Flag::promo_r>(); break;
+        case Flag::promo_q: func.template operator()<Flag::promo_q>(); break;
+        case Flag::promo_x_n: func.template operator()<Flag::promo_x_n>(); break;
+        case Flag::promo_x_b: func.template operator()<Flag::promo_x_b>(); break;
+        case Flag::promo_x_r: func.template operator()<Flag::promo_x_r>(); break;
+        case Flag::promo_x_q: func.template operator()<Flag::promo_x_q>(); break;
+        default: assert(false && "unused move flag"); break;
+    }
+}
+
 inline std::string Move::toLongAlgebraic() const
 {
     std::string moveStr = "";
@@ -159,17 +192,25 @@ inline std::string Move::toLongAlgebraic() const
     return moveStr;
 }
 
+// the vectorized serializer stores whole registers, up to 32 moves past the end of the list
+#define SERIALIZE_SLACK 32
+
 struct MoveList {
-    std::array<Move, 256> moves = { Move() };   // max moves in a position is 218, this way we only need 512 bytes
-    uint8_t count = 0;                          // enough for 256 moves
+    static constexpr size_t capacity = 256;     // max moves in a position is 218
+
+    std::array<Move, capacity + SERIALIZE_SLACK> moves;    // left uninitialized
+    uint16_t count = 0;
 
     constexpr void add(Move move)
     {
-        if ( count < moves.size() ) {
+        if ( count < capacity ) {
             moves[count++] = move;
         }
     }
 
+    // used by the serializer after it wrote moves past end(), not bounds checked
+    constexpr void setEnd(const Move* new_end) { count = new_end - moves.data(); }
+
     constexpr void remove(size_t index)
     {
         if ( index < count ) {
@@ -1,12 +1,99 @@
 #include "leapers.h"
 
 // ================================
-// MOVE GENERATION FUNCTIONS
+// ATTACK TABLES
 // ================================
 
+constexpr uint64_t leapers::generateKingMask(uint64_t king)
+{
+    const uint64_t up = north_west(king) | north(king) | north_east(king);
+    const uint64_t down = south_west(king) | south(king) | south_east(king);
+    const uint64_t left = west(king);
+    const uint64_t right = east(king);
+
+    return up | down | left | right;
+}
+
+constexpr uint64_t leapers::generateKnightMask(uint64_t knights)
+{
+    const uint64_t up_left = ((knights & ~(RANK_78 | FILE_A)) << 15);
+    const uint64_t up_right = ((knights & ~(RANK_78 | FILE_H)) << 17);
+    const uint64_t up = up_left | up_right;
+
+    const uint64_t down_left = ((knights & ~(RANK_12 | FILE_A)) >> 17);
+    const uint64_t down_right = ((knights & ~(RANK_12 | FILE_H)) >> 15);
+    const uint64_t down = down_left | down_right;
+
+    const uint64_t right_up = ((knights & ~(FILE_GH | RANK_8)) << 10);
+    const uint64_t right_down = ((knights & ~(FILE_GH | RANK_1)) >> 6);
+    const uint64_t right = right_up | right_down;
+
+    const uint64_t left_up = ((knights & ~(FILE_AB | RANK_8)) << 6);
+    const uint64_t left_down = ((knights & ~(FILE_AB | RANK_1)) >> 10);
+    const uint64_t left = left_up | left_down;
+
+    return up | down | left | right;
+}
+
 template <Color color>
-void leapers::pawn(MoveList& move_list, const Board& board)
+constexpr uint64_t leapers::generatePawnMask(uint64_t pawns)
+{
+    if constexpr ( utils::isWhite(color) ) {
+        const uint64_t left = north_west(pawns);
+        const uint64_t right = north_east(pawns);
+        return (left | right);
+    }
+    else {
+        const uint64_t left = south_west(pawns);
+        const uint64_t right = south_east(pawns);
+        return (left | right);
+    }
+}
+
+template <typename Mask>
+constexpr std::array<u64, 64> generate_leaper_table(Mask mask)
+{
+    std::array<u64, 64> table {};
+    for ( int square = 0; square < 64; ++square ) {
+        table[square] = mask(single_bit_u64(square));
+    }
+    return table;
+}
+
+// generated at compile time, they end up in .rodata and need no initialization
+inline constexpr std::array<u64, 64> white_pawn_attacks = generate_leaper_table(leapers::generatePawnMask<Color::white>);
+inline constexpr std::array<u64, 64> black_pawn_attacks = generate_leaper_table(leapers::generatePawnMask<Color::black>);
+inline constexpr std::array<u64, 64> knight_attacks = generate_leaper_table(leapers::generateKnightMask);
+inline constexpr std::array<u64, 64> king_attacks = generate_leaper_table(leapers::generateKingMask);
+
+inline u64 leapers::getKnightAttackMask(u64 knights)
+{
+    uint64_t result = 0ULL;
+    BIT_LOOP(knights)
+    {
+        const int from = get_LSB(knights);
+        result |= knight_attacks[from];
+    }
+    return result;
+}
+
+inline u64 leapers::getKingAttackMask(u64 king)
 {
+    const int from = get_LSB(king);
+    const uint64_t result = king_attacks[from];
+    return result;
+}
+
+// ================================
+// MOVE GENERATION FUNCTIONS
+// ================================
+
+template <Color color, GenType gen>
+void leapers::pawn(MoveList& move_list, const Board& board, uint64_t targets)
+{
+    constexpr bool gen_quiets = gen != GenType::captures;
+    constexpr bool gen_captures = gen != GenType::quiets;
+
     constexpr bool is_white = utils::isWhite(color);
     static constexpr int OFFSET_MOVE = (is_white) ? Directions::South : Directions::North;
     static constexpr int OFFSET_PUSH = (is_white) ? 2 * Directions::South : 2 * Directions::North;
@@ -19,8 +106,16 @@ void leapers::pawn(MoveList& move_list, const Board& board)
     static constexpr uint64_t PUSH_RANK = (is_white) ? RANK_2 : RANK_7;
 
     const uint64_t occupancy = board.getOccupancy();
-    const uint64_t enemy = board.getEnemy<color>();
-    const uint64_t ep_field = board.getEpField();
+    const uint64_t enemy = board.getEnemy<color>() & targets;
+
+    uint64_t ep_field = board.getEpField();
+    if constexpr ( gen == GenType::evasions ) {
+        // en passant evades a check if it captures the checking pawn or blocks the ray
+        const uint64_t ep_pawn = is_white ? south(ep_field) : north(ep_field);
+        if ( !((ep_field | ep_pawn) & targets) ) {
+            ep_field = 0ULL;
+        }
+    }
 
     const uint64_t pawns = board.getPieces<PieceType::pawn, color>();
 
@@ -36,64 +131,38 @@ void leapers::pawn(MoveList& move_list, const Board& board)
     const uint64_t promo_capture_l = promotable_pawns & ~LEFT_FILE;
     const uint64_t promo_capture_r = promotable_pawns & ~RIGHT_FILE;
 
-    uint64_t quiet = pawnMove<color>(move_pawns, occupancy);
-    BIT_LOOP(quiet)
-    {
-        const uint64_t to = get_LSB(quiet);
-        const uint64_t from = to + OFFSET_MOVE;
-        move_list.add(Move::make<Move::Flag::quiet>(from, to));
-    }
-
+    if constexpr ( gen_quiets ) {
+        const uint64_t quiet = pawnMove<color>(move_pawns, occupancy) & targets;
+        serialize::withOffset<Move::Flag::quiet, OFFSET_MOVE>(move_list, quiet);
 
-    uint64_t push = pawnPush<color>(push_pawns, occupancy);
-    BIT_LOOP(push)
-    {
-        const uint64_t to = get_LSB(push);
-        const uint64_t from = to + OFFSET_PUSH;
-        move_list.add(Move::make<Move::Flag::pawn_push>(from, to));
+        const uint64_t push = pawnPush<color>(push_pawns, occupancy) & targets;
+        serialize::withOffset<Move::Flag::pawn_push, OFFSET_PUSH>(move_list, push);
     }
 
+    if constexpr ( !gen_captures ) {
+        return;
+    }
 
     {
-        uint64_t left_ep = pawnAttackLeft<color>(attack_pawns_l, ep_field);
-        BIT_LOOP(left_ep)
-        {
-            const uint64_t to = get_LSB(left_ep);
-            const uint64_t from = to + OFFSET_ATTACK_L;
-            move_list.add(Move::make<Move::Flag::ep>(from, to));
-        }
+        const uint64_t left_ep = pawnAttackLeft<color>(attack_pawns_l, ep_field);
+        serialize::withOffset<Move::Flag::ep, OFFSET_ATTACK_L>(move_list, left_ep);
 
-        uint64_t right_ep = pawnAttackRight<color>(attack_pawns_r, ep_field);
-        BIT_LOOP(right_ep)
-        {
-            const uint64_t to = get_LSB(right_ep);
-            const uint64_t from = to + OFFSET_ATTACK_R;
-            move_list.add(Move::make<Move::Flag::ep>(from, to));
-        }
+        const uint64_t right_ep = pawnAttackRight<color>(attack_pawns_r, ep_field);
+        serialize::withOffset<Move::Flag::ep, OFFSET_ATTACK_R>(move_list, right_ep);
     }
 
 
     {
-        uint64_t left_attacks = pawnAttackLeft<color>(attack_pawns_l, enemy);
-        BIT_LOOP(left_attacks)
-        {
-            const uint64_t to = get_LSB(left_attacks);
-            const uint64_t from = to + OFFSET_ATTACK_L;
-            move_list.add(Move::make<Move::Flag::capture>(from, to));
-        }
+        const uint64_t left_attacks = pawnAttackLeft<color>(attack_pawns_l, enemy);
+        serialize::withOffset<Move::Flag::capture, OFFSET_ATTACK_L>(move_list, left_attacks);
 
-        uint64_t right_attacks = pawnAttackRight<color>(attack_pawns_r, enemy);
-        BIT_LOOP(right_attacks)
-        {
-            const uint64_t to = get_LSB(right_attacks);
-            const uint64_t from = to + OFFSET_ATTACK_R;
-            move_list.add(Move::make<Move::Flag::capture>(from, to));
-        }
+        const uint64_t right_attacks = pawnAttackRight<color>(attack_pawns_r, enemy);
+        serialize::withOffset<Move::Flag::capture, OFFSET_ATTACK_R>(move_list, right_attacks);
     }
 
 
     {
-        uint64_t quiet_promo = pawnMove<color>(promotable_pawns, occupancy);
+        uint64_t quiet_promo = pawnMove<color>(promotable_pawns, occupancy) & targets;
         BIT_LOOP(quiet_promo)
         {
             const uint64_t to = get_LSB(quiet_promo);
@@ -131,34 +200,30 @@ void leapers::pawn(MoveList& move_list, const Board& board)
     }
 }
 
-template <Color color>
-void leapers::knight(MoveList& move_list, const Board& board)
+template <Color color, GenType gen>
+void leapers::knight(MoveList& move_list, const Board& board, uint64_t targets)
 {
-    const uint64_t occupancy = board.getOccupancy();
-    const uint64_t enemy = board.getEnemy<color>();
+    const uint64_t empty = ~board.getOccupancy() & targets;
+    const uint64_t enemy = board.getEnemy<color>() & targets;
 
     uint64_t knights = board.getPieces<PieceType::knight, color>();
     BIT_LOOP(knights)
     {
         const uint64_t from = get_LSB(knights);
 
-        uint64_t move_targets = knight_attacks[from] & ~occupancy;
-        BIT_LOOP(move_targets)
-        {
-            const uint64_t to = get_LSB(move_targets);
-            move_list.add(Move::make<Move::Flag::quiet>(from, to));
+        if constexpr ( gen != GenType::captures ) {
+            const uint64_t move_targets = knight_attacks[from] & empty;
+            serialize::fromSquare<Move::Flag::quiet>(move_list, from, move_targets);
         }
 
-        uint64_t attack_targets = knight_attacks[from] & enemy;
-        BIT_LOOP(attack_targets)
-        {
-            const uint64_t to = get_LSB(attack_targets);
-            move_list.add(Move::make<Move::Flag::capture>(from, to));
+        if constexpr ( gen != GenType::quiets ) {
+            const uint64_t attack_targets = knight_attacks[from] & enemy;
+            serialize::fromSquare<Move::Flag::capture>(move_list, from, attack_targets);
         }
     }
 }
 
-template <Color color>
+template <Color color, GenType gen>
 void leapers::king(MoveList& move_list, const Board& board, uint64_t enemy_attacks)
 {
     const uint64_t occupancy = board.getOccupancy();
@@ -167,26 +232,25 @@ void leapers::king(MoveList& move_list, const Board& board, uint64_t enemy_attac
     uint64_t king = board.getPieces<PieceType::king, color>();
     const uint64_t from = get_LSB(king);
 
-    uint64_t moves = king_attacks[from] & ~occupancy & ~enemy_attacks;
-    BIT_LOOP(moves)
-    {
-        const uint64_t to = get_LSB(moves);
-        move_list.add(Move::make<Move::Flag::quiet>(from, to));
+    if constexpr ( gen != GenType::captures ) {
+        const uint64_t moves = king_attacks[from] & ~occupancy & ~enemy_attacks;
+        serialize::fromSquare<Move::Flag::quiet>(move_list, from, moves);
     }
 
-    uint64_t attacks = king_attacks[from] & enemy;
-    BIT_LOOP(attacks)
-    {
-        const uint64_t to = get_LSB(attacks);
-        move_list.add(Move::make<Move::Flag::capture>(from, to));
+    if constexpr ( gen != GenType::quiets ) {
+        const uint64_t attacks = king_attacks[from] & enemy;
+        serialize::fromSquare<Move::Flag::capture>(move_list, from, attacks);
     }
 
-    if ( board.canCastleKs<color>(enemy_attacks) ) {
-        move_list.add(Move::make<Move::Flag::castle_k>(from, from + 2));
-    }
+    // we can not castle out of check
+    if constexpr ( gen == GenType::all || gen == GenType::quiets ) {
+        if ( board.canCastleKs<color>(enemy_attacks) ) {
+            move_list.add(Move::make<Move::Flag::castle_k>(from, from + 2));
+        }
 
-    if ( board.canCastleQs<color>(enemy_attacks) ) {
-        move_list.add(Move::make<Move::Flag::castle_q>(from, from - 2));
+        if ( board.canCastleQs<color>(enemy_attacks) ) {
+            move_list.add(Move::make<Move::Flag::castle_q>(from, from - 2));
+        }
     }
 }
 
@@ -194,52 +258,6 @@ void leapers::king(MoveList& move_list, const Board& board, uint64_t enemy_attac
 // MASK GENERATORS
 // ================================
 
-inline uint64_t leapers::generateKingMask(uint64_t king)
-{
-    const uint64_t up = north_west(king) | north(king) | north_east(king);
-    const uint64_t down = south_west(king) | south(king) | south_east(king);
-    const uint64_t left = west(king);
-    const uint64_t right = east(king);
-
-    return up | down | left | right;
-}
-
-inline uint64_t leapers::generateKnightMask(uint64_t knights)
-{
-    const uint64_t up_left = ((knights & ~(RANK_78 | FILE_A)) << 15);
-    const uint64_t up_right = ((knights & ~(RANK_78 | FILE_H)) << 17);
-    const uint64_t up = up_left | up_right;
-
-    const uint64_t down_left = ((knights & ~(RANK_12 | FILE_A)) >> 17);
-    const uint64_t down_right = ((knights & ~(RANK_12 | FILE_H)) >> 15);
-    const uint64_t down = down_left | down_right;
-
-    const uint64_t right_up = ((knights & ~(FILE_GH | RANK_8)) << 10);
-    const uint64_t right_down = ((knights & ~(FILE_GH | RANK_1)) >> 6);
-    const uint64_t right = right_up | right_down;
-
-    const uint64_t left_up = ((knights & ~(FILE_AB | RANK_8)) << 6);
-    const uint64_t left_down = ((knights & ~(FILE_AB | RANK_1)) >> 10);
-    const uint64_t left = left_up | left_down;
-
-    return up | down | left | right;
-}
-
-template <Color color>
-inline uint64_t leapers::generatePawnMask(uint64_t pawns)
-{
-    if constexpr ( utils::isWhite(color) ) {
-        const uint64_t left = north_west(pawns);
-        const uint64_t right = north_east(pawns);
-        return (left | right);
-    }
-    else {
-        const uint64_t left = south_west(pawns);
-        const uint64_t right = south_east(pawns);
-        return (left | right);
-    }
-}
-
 template <Color color>
 inline uint64_t leapers::pawnMove(uint64_t pawns, uint64_t occupancy)
 {
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "move_generation.h"
+
+// ================================
+// PSEUDOLEGAL CHECK
+// ================================
+
+template <Color color>
+bool Board::isPseudoLegal(const Move& move) const
+{
+    constexpr bool is_white = utils::isWhite(color);
+    constexpr int PAWN_STEP = is_white ? Directions::North : Directions::South;
+    constexpr uint64_t PROMO_RANK = is_white ? RANK_7 : RANK_2;
+    constexpr uint64_t PUSH_RANK = is_white ? RANK_2 : RANK_7;
+    constexpr int KING_START = is_white ? 4 : 60;
+
+    const int from = move.getFrom();
+    const int to = move.getTo();
+
+    if ( from == to ) {
+        return false;   // catches the null move as well
+    }
+
+    const Piece piece = getPiece(from);
+    if ( utils::pieceColor(piece) != color ) {
+        return false;
+    }
+
+    const uint64_t from_mask = single_bit_u64(from);
+    const uint64_t to_mask = single_bit_u64(to);
+    const uint64_t occupancy = getOccupancy();
+    const uint64_t enemy = getEnemy<color>();
+
+    const bool is_pawn = utils::getPieceType(piece) == PieceType::pawn;
+    const bool on_promo_rank = (from_mask & PROMO_RANK) != 0ULL;
+    const uint64_t pawn_attacks = is_white ? white_pawn_attacks[from] : black_pawn_attacks[from];
+    const bool is_single_step = (to == from + PAWN_STEP) && !(to_mask & occupancy);
+
+    // targets of a non-pawn piece, pawns are handled per flag
+    auto pieceTargets = [&]() -> uint64_t {
+        switch ( utils::getPieceType(piece) ) {
+            case PieceType::knight: return knight_attacks[from];
+            case PieceType::bishop: return sliders::getBitboard<PieceType::bishop>(from_mask, occupancy);
+            case PieceType::rook: return sliders::getBitboard<PieceType::rook>(from_mask, occupancy);
+            case PieceType::queen: return sliders::getBitboard<PieceType::queen>(from_mask, occupancy);
+            case PieceType::king: return king_attacks[from];
+            default: return 0ULL;
+        }
+    };
+
+    switch ( move.getFlag() ) {
+        case Move::Flag::quiet: {
+            if ( to_mask & occupancy ) {
+                return false;
+            }
+
+            if ( is_pawn ) {
+                return is_single_step && !on_promo_rank;
+            }
+
+            return (pieceTargets() & to_mask) != 0ULL;
+        }
+        case Move::Flag::pawn_push: {
+            if ( !is_pawn || !(from_mask & PUSH_RANK) || to != from + 2 * PAWN_STEP ) {
+                return false;
+            }
+
+            const uint64_t path = single_bit_u64(from + PAWN_STEP) | to_mask;
+            return !(path & occupancy);
+        }
+        case Move::Flag::castle_k: {
+            if ( piece != utils::getPiece(PieceType::king, color) || from != KING_START || to != from + 2 ) {
+                return false;
+            }
+
+            return canCastleKs<color>(attacked_squares<utils::switchColor(color)>(*this));
+        }
+        case Move::Flag::castle_q: {
+            if ( piece != utils::getPiece(PieceType::king, color) || from != KING_START || to != from - 2 ) {
+                return false;
+            }
+
+            return canCastleQs<color>(attacked_squares<utils::switchColor(color)>(*this));
+        }
+        case Move::Flag::capture: {
+            if ( !(to_mask & enemy) ) {
+                return false;
+            }
+
+            if ( is_pawn ) {
+                return !on_promo_rank && (pawn_attacks & to_mask);
+            }
+
+            return (pieceTargets() & to_mask) != 0ULL;
+        }
+        case Move::Flag::ep: {
+            return is_pawn && (to_mask == getEpField()) && (pawn_attacks & to_mask);
+        }
+        case Move::Flag::promo_n:
+        case Move::Flag::promo_b:
+        case Move::Flag::promo_r:
+        case Move::Flag::promo_q: {
+            return is_pawn && on_promo_rank && is_single_step;
+        }
+        case Move::Flag::promo_x_n:
+        case Move::Flag::promo_x_b:
+        case Move::Flag::promo_x_r:
+        case Move::Flag::promo_x_q: {
+            return is_pawn && on_promo_rank && (pawn_attacks & to_mask & enemy);
+        }
+        default: return false; // 0b0110 and 0b0111 are unused
+    }
+}
+
+// ================================
+// LEGALITY CHECK
+// ================================
+
+template <Color color>
+bool Board::isLegal(const Move& move) const
+{
+    constexpr Color enemy_color = utils::switchColor(color);
+    constexpr int EP_OFFSET = utils::isWhite(color) ? Directions::South : Directions::North;
+
+    const int from = move.getFrom();
+    const int to = move.getTo();
+    const uint64_t from_mask = single_bit_u64(from);
+    const uint64_t to_mask = single_bit_u64(to);
+
+    const uint64_t king = getPieces<PieceType::king, color>();
+    const uint64_t occupancy = getOccupancy();
+
+    if ( from_mask & king ) {
+        // castling squares were already checked by the generator / isPseudoLegal, the king only has to be safe on 'to'
+        // remove the king, otherwise it would block the ray of a slider that gives check
+        const uint64_t attackers = attackers_to<enemy_color>(*this, to, occupancy ^ from_mask);
+        return (attackers & ~to_mask) == 0ULL;
+    }
+
+    uint64_t captured = to_mask;
+    uint64_t new_occupancy = (occupancy ^ from_mask) | to_mask;
+
+    if ( move.isEnpassant() ) {
+        captured = single_bit_u64(to + EP_OFFSET);
+        new_occupancy ^= captured;
+    }
+
+    const uint64_t attackers = attackers_to<enemy_color>(*this, get_LSB(king), new_occupancy);
+    return (attackers & ~captured) == 0ULL;
+}
@@ -20,6 +20,8 @@
 
 #include "leapers/leapers.h"
 #include "sliders/sliders.h"
+#include "sliders/kogge_stone.h"
+#include "rays.h"
 #include "board/board.h"
 #include "move.h"
 
@@ -30,8 +32,50 @@ static bool initialized_stuff = false;
 inline void initializePrecomputedStuff()
 {
     magic::initMagics();
-    leapers::initLeapers();
-    Zobrist::initialize();
+}
+
+/**
+ * @brief   Generates a bitboard of all pieces of a color that attack a square.
+ *
+ * @tparam color        color of the attacking pieces
+ * @param board         a board
+ * @param square        the attacked square
+ * @param occupancy     occupancy used for the slider lookups, lets us check positions after a move without making it
+ * @return u64          the attacking pieces
+ */
+template <Color color>
+inline u64 attackers_to(const Board& board, int square, u64 occupancy)
+{
+    // a pawn of 'color' attacks the square if a pawn of the other color on that square would attack it
+    const u64 pawn_mask = utils::isWhite(color) ? black_pawn_attacks[square] : white_pawn_attacks[square];
+
+    const u64 queens = board.getPieces<PieceType::queen, color>();
+    const u64 diagonal = board.getPieces<PieceType::bishop, color>() | queens;
+    const u64 straight = board.getPieces<PieceType::rook, color>() | queens;
+    const u64 square_mask = single_bit_u64(square);
+
+    return (pawn_mask & board.getPieces<PieceType::pawn, color>())
+        | (knight_attacks[square] & board.getPieces<PieceType::knight, color>())
+        | (king_attacks[square] & board.getPieces<PieceType::king, color>())
+        | (sliders::getBitboard<PieceType::bishop>(square_mask, occupancy) & diagonal)
+        | (sliders::getBitboard<PieceType::rook>(square_mask, occupancy) & straight);
+}
+
+/**
+ * @brief   All squares attacked by color, read from the attack map if the board keeps one.
+ *
+ * @tparam color        color of the attacking pieces
+ * @param board         a board
+ * @return u64          the ORed attacks
+ */
+template <Color color>
+inline u64 attacked_squares(const Board& board)
+{
+    if ( board.hasAttackMap() ) {
+        return board.getAttackMap().getAttacks<color>();
+    }
+
+    return generate_attacks<color>(board);
 }
 
 /**
@@ -39,21 +83,63 @@ inline void initializePrecomputedStuff()
  *                      even illegal ones. We will filter the list later.
  *
  * @tparam color        Player for whom we are generating moves
+ * @tparam gen          Only generate captures (and promotions) or quiets, used by the staged MovePicker
  * @param move_list     A container that can store our generated moves
  * @param board         The current board representation
  */
-template <Color color>
+template <Color color, GenType gen = GenType::all>
 inline u64 pseudolegal_moves(MoveList& move_list, const Board& board)
 {
-    const u64 enemy_attacks = generate_attacks<utils::switchColor(color)>(board);
+    // the enemy attacks are only needed for quiet king moves and castling
+    u64 enemy_attacks = 0ULL;
+    if constexpr ( gen != GenType::captures ) {
+        enemy_attacks = attacked_squares<utils::switchColor(color)>(board);
+    }
+
+    leapers::pawn<color, gen>(move_list, board);
+    leapers::knight<color, gen>(move_list, board);
+    leapers::king<color, gen>(move_list, board, enemy_attacks);
+
+    sliders::generateMoves<PieceType::bishop, color, gen>(move_list, board);
+    sliders::generateMoves<PieceType::rook, color, gen>(move_list, board);
+    sliders::generateMoves<PieceType::queen, color, gen>(move_list, board);
+
+    return move_list.size();
+}
+
+/**
+ * @brief               Generates the pseudolegal moves for a position where the side to move is in check.
+ *                      In double check only the king can move, otherwise we can only move the king,
+ *                      capture the checker or block the ray between the checker and the king.
+ *
+ * @tparam color        Player for whom we are generating moves, has to be in check
+ * @param move_list     A container that can store our generated moves
+ * @param board         The current board representation
+ * @param checkers      The enemy pieces that give check, see attackers_to
+ */
+template <Color color>
+inline u64 evasion_moves(MoveList& move_list, const Board& board, u64 checkers)
+{
+    constexpr GenType gen = GenType::evasions;
+    const u64 enemy_attacks = attacked_squares<utils::switchColor(color)>(board);
+
+    leapers::king<color, gen>(move_list, board, enemy_attacks);
 
-    leapers::pawn<color>(move_list, board);
-    leapers::knight<color>(move_list, board);
-    leapers::king<color>(move_list, board, enemy_attacks);
+    if ( get_bit_count(checkers) > 1 ) {
+        return move_list.size();
+    }
 
-    sliders::generateMoves<PieceType::bishop, color>(move_list, board);
-    sliders::generateMoves<PieceType::rook, color>(move_list, board);
-    sliders::generateMoves<PieceType::queen, color>(move_list, board);
+    const u64 king = board.getPieces<PieceType::king, color>();
+    const int king_square = get_LSB(king);
+    // a checking slider sees the king, so the squares between are empty, for leapers there are none
+    const u64 targets = checkers | between_bb[king_square][get_LSB(checkers)];
+
+    leapers::pawn<color, gen>(move_list, board, targets);
+    leapers::knight<color, gen>(move_list, board, targets);
+
+    sliders::generateMoves<PieceType::bishop, color, gen>(move_list, board, targets);
+    sliders::generateMoves<PieceType::rook, color, gen>(move_list, board, targets);
+    sliders::generateMoves<PieceType::queen, color, gen>(move_list, board, targets);
 
     return move_list.size();
 }
@@ -85,20 +171,23 @@ inline u64 generate_moves(MoveList& move_list, Board& board)
         if not we.. could maybe filter for possible blockers but idk how
 */
 
-    pseudolegal_moves<color>(move_list, board);
-
-    for ( size_t i = 0; i < move_list.size(); ) {
-        board.move<color>(move_list[i]);
+    const u64 king = board.getPieces<PieceType::king, color>();
+    const int king_square = get_LSB(king);
+    const u64 checkers = attackers_to<utils::switchColor(color)>(board, king_square, board.getOccupancy());
 
-        const u64 enemy_attacks = generate_attacks<utils::switchColor(color)>(board);
+    if ( checkers ) {
+        evasion_moves<color>(move_list, board, checkers);
+    }
+    else {
+        pseudolegal_moves<color>(move_list, board);
+    }
 
-        if ( board.isCheck<color>(enemy_attacks) ) {
-            board.undo<color>(move_list[i]);
-            move_list.remove(i);
+    for ( size_t i = 0; i < move_list.size(); ) {
+        if ( board.isLegal<color>(move_list[i]) ) {
+            ++i;
         }
         else {
-            board.undo<color>(move_list[i]);
-            ++i;
+            move_list.remove(i);
         }
     }
 
@@ -109,10 +198,11 @@ inline u64 generate_moves(MoveList& move_list, Board& board)
  * @brief   Generates a bitboard containing all fields that enemies can attack
  *
  * @tparam enemyColor   color of the enemy
+ * @tparam kernel       how the slider attacks are computed, Kogge-Stone fills were faster than magics (-attackbench)
  * @param board         a board
  * @return u64          the ORed enemy attacks
  */
-template <Color color>
+template <Color color, AttackKernel kernel = AttackKernel::kogge_stone>
 inline u64 generate_attacks(const Board& board)
 {
     u64 attacks = 0ULL;
@@ -126,9 +216,14 @@ inline u64 generate_attacks(const Board& board)
     const u64 knights = board.getPieces<PieceType::knight, color>();
     const u64 king = board.getPieces<PieceType::king, color>();
 
-    attacks |= sliders::getBitboard<PieceType::bishop>(bishops, occupancy);
-    attacks |= sliders::getBitboard<PieceType::rook>(rooks, occupancy);
-    attacks |= sliders::getBitboard<PieceType::queen>(queens, occupancy);
+    if constexpr ( kernel == AttackKernel::kogge_stone ) {
+        attacks |= kogge_stone::attacksScalar(bishops | queens, rooks | queens, occupancy);
+    }
+    else {
+        attacks |= sliders::getBitboard<PieceType::bishop>(bishops, occupancy);
+        attacks |= sliders::getBitboard<PieceType::rook>(rooks, occupancy);
+        attacks |= sliders::getBitboard<PieceType::queen>(queens, occupancy);
+    }
 
     attacks |= leapers::getPawnAttackMask<color>(pawns);
     attacks |= leapers::getKnightAttackMask(knights);
@@ -136,3 +231,5 @@ inline u64 generate_attacks(const Board& board)
 
     return attacks;
 }
+
+#include "legality_impl.hpp"
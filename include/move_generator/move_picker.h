@@ -0,0 +1,210 @@
+/**
+ * @file move_picker.h
+ * @brief   Staged move generation for the search.
+ *
+ * Most nodes in a well ordered search cut off on the first or second move, so we only generate
+ * what we need right now:
+ *  1. the hash move, without generating anything
+ *  2. captures and promotions, ordered by MVV-LVA
+ *  3. the killer moves, again without generating anything
+ *  4. the quiet moves, only if nothing has cut off yet
+ *
+ * If the side to move is in check we only generate evasions after the hash move, ordered like captures.
+ *
+ * The picker returns pseudolegal moves, the caller still has to check them with Board::isLegal.
+ * The moves, scores and killers live in the SearchFrame of the current ply, so the picker itself is tiny.
+ */
+
+#pragma once
+
+#include <array>
+
+#include "definitions.h"
+#include "move.h"
+#include "board/board.h"
+#include "move_generation.h"
+#include "search_stack.h"
+
+template <Color color>
+class MovePicker {
+public:
+    enum class Stage {
+        hash_move, generate_captures, captures, killers, generate_quiets, quiets,
+        evasion_hash_move, generate_evasions, evasions,
+        done
+    };
+
+    MovePicker(const Board& board, Move hash_move, SearchFrame& frame)
+        : board(board), hash_move(hash_move), killers(frame.killers), moves(frame.moves), scores(frame.scores)
+    {
+        moves.clear();
+
+        const u64 king = board.getPieces<PieceType::king, color>();
+        const int king_square = get_LSB(king);
+        checkers = attackers_to<utils::switchColor(color)>(board, king_square, board.getOccupancy());
+
+        if ( checkers ) {
+            stage = Stage::evasion_hash_move;
+        }
+    }
+
+    /**
+     * @brief   Get the next pseudolegal move, moves that were already returned by an earlier stage are skipped.
+     *
+     * @return Move     the next move, or Move() if there are no moves left
+     */
+    Move next();
+
+    constexpr Stage getStage() const { return stage; }
+    constexpr bool inCheck() const { return checkers != 0ULL; }
+
+private:
+    const Board& board;
+    const Move hash_move;
+    const std::array<Move, 2> killers;
+
+    Stage stage = Stage::hash_move;
+    u64 checkers = 0ULL;
+    size_t index = 0;
+    size_t killer_index = 0;
+
+    MoveList& moves;
+    std::array<int, 256>& scores;
+
+    void scoreCaptures();
+    Move pickBestCapture();
+
+    constexpr bool isKiller(const Move& move) const { return move == killers[0] || move == killers[1]; }
+};
+
+template <Color color>
+Move MovePicker<color>::next()
+{
+    switch ( stage ) {
+        case Stage::hash_move: {
+            stage = Stage::generate_captures;
+            if ( hash_move != Move() && board.isPseudoLegal<color>(hash_move) ) {
+                return hash_move;
+            }
+        } [[fallthrough]];
+
+        case Stage::generate_captures: {
+            pseudolegal_moves<color, GenType::captures>(moves, board);
+            scoreCaptures();
+            index = 0;
+            stage = Stage::captures;
+        } [[fallthrough]];
+
+        case Stage::captures: {
+            while ( index < moves.size() ) {
+                const Move move = pickBestCapture();
+                if ( move != hash_move ) {
+                    return move;
+                }
+            }
+
+            stage = Stage::killers;
+        } [[fallthrough]];
+
+        case Stage::killers: {
+            while ( killer_index < killers.size() ) {
+                const Move killer = killers[killer_index++];
+
+                // killers are quiet moves from a sibling node, they might not exist in this position
+                if ( killer != Move() && killer != hash_move && !killer.isCapture() && !killer.isPromotion()
+                    && board.isPseudoLegal<color>(killer) ) {
+                    return killer;
+                }
+            }
+
+            stage = Stage::generate_quiets;
+        } [[fallthrough]];
+
+        case Stage::generate_quiets: {
+            moves.clear();
+            pseudolegal_moves<color, GenType::quiets>(moves, board);
+            index = 0;
+            stage = Stage::quiets;
+        } [[fallthrough]];
+
+        case Stage::quiets: {
+            while ( index < moves.size() ) {
+                const Move move = moves[index++];
+                if ( move != hash_move && !isKiller(move) ) {
+                    return move;
+                }
+            }
+
+            stage = Stage::done;
+            break;
+        }
+
+        case Stage::evasion_hash_move: {
+            stage = Stage::generate_evasions;
+            if ( hash_move != Move() && board.isPseudoLegal<color>(hash_move) ) {
+                return hash_move;
+            }
+        } [[fallthrough]];
+
+        case Stage::generate_evasions: {
+            evasion_moves<color>(moves, board, checkers);
+            scoreCaptures();
+            index = 0;
+            stage = Stage::evasions;
+        } [[fallthrough]];
+
+        case Stage::evasions: {
+            while ( index < moves.size() ) {
+                const Move move = pickBestCapture();
+                if ( move != hash_move ) {
+                    return move;
+                }
+            }
+
+            stage = Stage::done;
+        } [[fallthrough]];
+
+        case Stage::done: break;
+    }
+
+    return Move();
+}
+
+template <Color color>
+void MovePicker<color>::scoreCaptures()
+{
+    // indexed by PieceType, the king value only matters as an attacker
+    // non captures (evasions) have no victim and end up behind all captures
+    static constexpr std::array<int, 7> piece_value = { 1, 3, 3, 5, 9, 20, 0 };
+
+    for ( size_t i = 0; i < moves.size(); ++i ) {
+        const Move move = moves[i];
+        const PieceType attacker = board.getPieceType(move.getFrom());
+        const PieceType victim = move.isEnpassant() ? PieceType::pawn : board.getPieceType(move.getTo());
+
+        // most valuable victim first, least valuable attacker breaks ties
+        int score = piece_value[utils::toByte(victim)] * 16 - piece_value[utils::toByte(attacker)];
+        if ( move.isPromotion() ) {
+            score += piece_value[utils::toByte(move.getPromotionPieceType())] * 16;
+        }
+
+        scores[i] = score;
+    }
+}
+
+template <Color color>
+Move MovePicker<color>::pickBestCapture()
+{
+    // selection sort step, we usually only look at the first few captures
+    size_t best = index;
+    for ( size_t i = index + 1; i < moves.size(); ++i ) {
+        if ( scores[i] > scores[best] ) {
+            best = i;
+        }
+    }
+
+    std::swap(moves[index], moves[best]);
+    std::swap(scores[index], scores[best]);
+
+    return moves[index++];
+}
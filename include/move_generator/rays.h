@@ -0,0 +1,90 @@
+/**
+ * @file rays.h
+ * @brief   Square to square tables for pin and check logic, generated at compile time.
+ *
+ * between_bb[a][b]         squares strictly between a and b, 0 if they are not on a common line
+ * line_bb[a][b]            the whole line (edge to edge) through a and b, 0 if they are not on a common line
+ * square_distance[a][b]    king steps from a to b
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "bitboard.h"
+
+namespace rays {
+
+struct LineTables {
+    std::array<std::array<u64, 64>, 64> between {};
+    std::array<std::array<u64, 64>, 64> line {};
+};
+
+// file / rank steps of the eight directions, a direction and its opposite are next to each other
+constexpr std::array<std::array<int, 2>, 8> directions = { {
+    { 0, 1 }, { 0, -1 }, { 1, 0 }, { -1, 0 }, { 1, 1 }, { -1, -1 }, { 1, -1 }, { -1, 1 }
+} };
+
+constexpr bool onBoard(int file, int rank) { return 0 <= file && file < 8 && 0 <= rank && rank < 8; }
+
+/**
+ * @brief   All squares reached from a square in one direction on an empty board.
+ *
+ * @param square
+ * @param df        file step
+ * @param dr        rank step
+ * @return u64
+ */
+constexpr u64 ray(int square, int df, int dr)
+{
+    u64 result = 0ULL;
+    for ( int file = square % 8 + df, rank = square / 8 + dr; onBoard(file, rank); file += df, rank += dr ) {
+        result |= single_bit_u64(rank * 8 + file);
+    }
+    return result;
+}
+
+constexpr LineTables generateLineTables()
+{
+    LineTables tables;
+
+    for ( int from = 0; from < 64; ++from ) {
+        for ( const auto& [df, dr] : directions ) {
+            const u64 line = ray(from, df, dr) | ray(from, -df, -dr) | single_bit_u64(from);
+
+            u64 path = 0ULL;
+            for ( int file = from % 8 + df, rank = from / 8 + dr; onBoard(file, rank); file += df, rank += dr ) {
+                const int to = rank * 8 + file;
+                tables.between[from][to] = path;
+                tables.line[from][to] = line;
+                path |= single_bit_u64(to);
+            }
+        }
+    }
+
+    return tables;
+}
+
+constexpr std::array<std::array<uint8_t, 64>, 64> generateDistances()
+{
+    std::array<std::array<uint8_t, 64>, 64> distances {};
+
+    for ( int a = 0; a < 64; ++a ) {
+        for ( int b = 0; b < 64; ++b ) {
+            const int files = a % 8 > b % 8 ? a % 8 - b % 8 : b % 8 - a % 8;
+            const int ranks = a / 8 > b / 8 ? a / 8 - b / 8 : b / 8 - a / 8;
+            distances[a][b] = static_cast<uint8_t>(files > ranks ? files : ranks);
+        }
+    }
+
+    return distances;
+}
+
+inline constexpr LineTables line_tables = generateLineTables();
+
+} // namespace rays
+
+inline constexpr const std::array<std::array<u64, 64>, 64>& between_bb = rays::line_tables.between;
+inline constexpr const std::array<std::array<u64, 64>, 64>& line_bb = rays::line_tables.line;
+inline constexpr std::array<std::array<uint8_t, 64>, 64> square_distance = rays::generateDistances();
@@ -0,0 +1,158 @@
+/**
+ * @file serialize.h
+ * @brief   Turns target bitboards into packed moves.
+ *
+ * Every move the generators emit has the form
+ *      raw = (flag << 12) | (from << 6) | to
+ * either with a fixed 'from' (pieces) or with 'from = to + offset' (pawns), which is
+ *      raw = base + to * step,     step = 1 or 65
+ * so serializing is: compress the set bit indices, widen them to 16 bit, multiply and add.
+ *
+ * There are three implementations, picked at compile time:
+ *  - AVX-512 VBMI2: VPCOMPRESSB the square indices of each half of the board, 16 moves per store
+ *  - AVX2: a 256 entry LUT of the set bit indices of a byte, 8 moves per non-empty byte (SSE4.1 instructions only)
+ *  - scalar: one bit at a time, but without the bounds check and count update of MoveList::add
+ *
+ * The vector paths are only used with SERIALIZE_SIMD (config.h). A piece has 2-8 targets most of the time,
+ * and for those the scalar loop was faster in perft on a Sapphire Rapids core (AVX2 ~8%, VBMI2 ~40% slower).
+ *
+ * The vector paths write full registers past the end of the list, MoveList keeps SERIALIZE_SLACK
+ * spare entries for that. Nothing here checks the bounds.
+ */
+
+#pragma once
+
+#include <array>
+
+#include "definitions.h"
+#include "bitboard.h"
+#include "move.h"
+#include "config.h"
+
+#if SERIALIZE_SIMD
+#include <immintrin.h>
+#endif
+
+namespace serialize {
+
+static_assert(sizeof(Move) == sizeof(uint16_t), "moves are written as raw 16 bit values");
+
+#if SERIALIZE_SIMD && defined(__AVX512VBMI2__) && defined(__AVX512VL__)
+
+inline Move* serialize(Move* out, uint16_t base, uint16_t step, u64 targets)
+{
+    // 256 bit registers only, a zmm version was slower still
+    static const __m256i indices = _mm256_setr_epi8(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+
+    const __m256i step_v = _mm256_set1_epi16(step);
+
+    for ( int half = 0; half < 64; half += 32 ) {
+        const uint32_t mask = static_cast<uint32_t>(targets >> half);
+        if ( !mask ) {
+            continue;
+        }
+
+        const __m256i squares = _mm256_maskz_compress_epi8(mask, indices);
+        const __m256i base_v = _mm256_set1_epi16(base + half * step);
+
+        const __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(squares));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_add_epi16(base_v, _mm256_mullo_epi16(lo, step_v)));
+
+        // a single piece never has more than 16 targets on one half of the board, this keeps it correct for any bitboard
+        const int count = get_bit_count(mask);
+        if ( count > 16 ) {
+            const __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(squares, 1));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 16), _mm256_add_epi16(base_v, _mm256_mullo_epi16(hi, step_v)));
+        }
+
+        out += count;
+    }
+
+    return out;
+}
+
+#elif SERIALIZE_SIMD && defined(__AVX2__)
+
+// set bit indices of every byte, padded with zeros
+inline constexpr std::array<uint64_t, 256> byte_lut = []() {
+    std::array<uint64_t, 256> lut {};
+    for ( int byte = 0; byte < 256; ++byte ) {
+        int count = 0;
+        for ( int bit = 0; bit < 8; ++bit ) {
+            if ( byte & (1 << bit) ) {
+                lut[byte] |= static_cast<uint64_t>(bit) << (8 * count++);
+            }
+        }
+    }
+    return lut;
+}();
+
+inline Move* serialize(Move* out, uint16_t base, uint16_t step, u64 targets)
+{
+    const __m128i step_v = _mm_set1_epi16(step);
+
+    while ( targets ) {
+        // skip empty bytes, most targets only touch two or three of them
+        const int shift = get_LSB(targets) & ~7;
+        const uint64_t byte = (targets >> shift) & 0xFF;
+        targets &= ~(0xFFULL << shift);
+
+        const __m128i squares = _mm_cvtepu8_epi16(_mm_cvtsi64_si128(byte_lut[byte]));
+        const __m128i moves = _mm_add_epi16(_mm_set1_epi16(base + shift * step), _mm_mullo_epi16(squares, step_v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), moves);
+
+        out += get_bit_count(byte);
+    }
+
+    return out;
+}
+
+#else
+
+inline Move* serialize(Move* out, uint16_t base, uint16_t step, u64 targets)
+{
+    BIT_LOOP(targets)
+    {
+        const uint16_t to = get_LSB(targets);
+        *out++ = Move(static_cast<uint16_t>(base + to * step));
+    }
+
+    return out;
+}
+
+#endif
+
+/**
+ * @brief   Adds a move from 'from' to every square in targets.
+ *
+ * @tparam flag         flag of all the moves
+ * @param move_list
+ * @param from          origin square
+ * @param targets       destination squares
+ */
+template <Move::Flag flag>
+inline void fromSquare(MoveList& move_list, int from, u64 targets)
+{
+    constexpr uint16_t flag_bits = static_cast<uint16_t>(flag) << 12;
+    move_list.setEnd(serialize(move_list.end(), flag_bits | (from << 6), 1, targets));
+}
+
+/**
+ * @brief   Adds a move to every square in targets, coming from 'to + offset' (pawn moves).
+ *
+ * @tparam flag         flag of all the moves
+ * @tparam offset       from - to
+ * @param move_list
+ * @param targets       destination squares
+ */
+template <Move::Flag flag, int offset>
+inline void withOffset(MoveList& move_list, u64 targets)
+{
+    // (to + offset) << 6 | to == offset * 64 + to * 65, the 16 bit wrap around takes care of negative offsets
+    constexpr uint16_t base = static_cast<uint16_t>((static_cast<int>(flag) << 12) + offset * 64);
+    move_list.setEnd(serialize(move_list.end(), base, 65, targets));
+}
+
+} // namespace serialize
@@ -0,0 +1,194 @@
+/**
+ * @file kogge_stone.h
+ * @brief   Set-wise slider attacks with Kogge-Stone occluded fills.
+ *
+ * The magic lookups in sliders.h need one lookup per piece and ~4MB of tables.
+ * For queries that only need the union of all attacks (generate_attacks) we can instead fill
+ * all sliders of one color at once, direction by direction, using nothing but shifts and masks:
+ *
+ *      gen |= pro & (gen << s);  pro &= (pro << s);     three times, with s, 2s and 4s
+ *      attacks = (gen << s) & wrap_mask
+ *
+ * 'gen' are the sliders, 'pro' the empty squares (minus the file that would wrap around).
+ * The AVX2 version runs four directions per register, one register for the left shifts and one for the right shifts.
+ * It loses to the scalar version (-attackbench: ~5ns vs ~3ns per call, the lane shuffling and the horizontal or
+ * eat the gain), so generate_attacks uses attacksScalar and the AVX2 version is only kept for the benchmark.
+ * The eval needs the attacks per color and piece type instead of the union, there are four independent sets per
+ * direction group and attacks4 puts one set in each lane, so nothing has to be or'ed across lanes.
+ *
+ * https://www.chessprogramming.org/Kogge-Stone_Algorithm
+ */
+
+#pragma once
+
+#include <array>
+
+#include "bitboard.h"
+#include "definitions.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace kogge_stone {
+
+// squares a fill may enter in each direction, the file on the other side would be a wrap around
+constexpr u64 NOT_A = ~FILE_A;
+constexpr u64 NOT_H = ~FILE_H;
+
+/**
+ * @brief   Occluded fill and the final shift for a single direction.
+ *
+ * @tparam shift    positive for north / east, negative for south / west
+ * @tparam wrap     squares that can be reached in this direction without wrapping around the board
+ * @param gen       sliders that move in this direction
+ * @param empty     empty squares
+ * @return u64      attacked squares in this direction
+ */
+template <int shift, u64 wrap>
+constexpr u64 directionAttacks(u64 gen, u64 empty)
+{
+    constexpr auto shifted = [](u64 b, int s) { return s > 0 ? (b << s) : (b >> -s); };
+
+    u64 pro = empty & wrap;
+    gen |= pro & shifted(gen, shift);
+    pro &= shifted(pro, shift);
+    gen |= pro & shifted(gen, 2 * shift);
+    pro &= shifted(pro, 2 * shift);
+    gen |= pro & shifted(gen, 4 * shift);
+
+    return shifted(gen, shift) & wrap;
+}
+
+/**
+ * @brief   All squares attacked by a set of sliders, scalar version.
+ *
+ * @param diagonal      bishops and queens
+ * @param orthogonal    rooks and queens
+ * @param occupancy     all pieces
+ * @return u64          union of all attacks
+ */
+constexpr u64 attacksScalar(u64 diagonal, u64 orthogonal, u64 occupancy)
+{
+    const u64 empty = ~occupancy;
+
+    return directionAttacks<Directions::North, FULL_BB>(orthogonal, empty)
+        | directionAttacks<Directions::South, FULL_BB>(orthogonal, empty)
+        | directionAttacks<Directions::East, NOT_A>(orthogonal, empty)
+        | directionAttacks<Directions::West, NOT_H>(orthogonal, empty)
+        | directionAttacks<Directions::NorthEast, NOT_A>(diagonal, empty)
+        | directionAttacks<Directions::NorthWest, NOT_H>(diagonal, empty)
+        | directionAttacks<Directions::SouthEast, NOT_A>(diagonal, empty)
+        | directionAttacks<Directions::SouthWest, NOT_H>(diagonal, empty);
+}
+
+/**
+ * @brief   Attacks of four independent sets of sliders that all move in the same four directions,
+ *          e.g. the bishops and queens of both colors. AVX2 with one set per lane if the build has it.
+ *
+ * @tparam diagonal     fill the diagonal directions, otherwise the orthogonal ones
+ * @param sets
+ * @param occupancy     all pieces
+ * @return std::array<u64, 4>   attacks of sets[i] in lane i
+ */
+template <bool diagonal>
+inline std::array<u64, 4> attacks4(const std::array<u64, 4>& sets, u64 occupancy)
+{
+    constexpr int shift_a = diagonal ? Directions::NorthEast : Directions::North;
+    constexpr int shift_b = diagonal ? Directions::NorthWest : Directions::East;
+    constexpr u64 wrap_a = diagonal ? NOT_A : FULL_BB;
+    constexpr u64 wrap_b = diagonal ? NOT_H : NOT_A;
+    // the opposite directions wrap around on the other side
+    constexpr u64 wrap_a_back = diagonal ? NOT_H : FULL_BB;
+    constexpr u64 wrap_b_back = diagonal ? NOT_A : NOT_H;
+
+    std::array<u64, 4> attacks;
+
+#if defined(__AVX2__)
+    const __m256i empty = _mm256_set1_epi64x(~occupancy);
+    const __m256i pieces = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sets.data()));
+
+    // same fill as directionAttacks, the shift is the same in all lanes so it can be an immediate
+    constexpr auto fill = []<int shift, u64 wrap>(__m256i gen, __m256i empty) {
+        constexpr auto shifted = [](__m256i b, int s) { return s > 0 ? _mm256_slli_epi64(b, s) : _mm256_srli_epi64(b, -s); };
+
+        const __m256i wrap_mask = _mm256_set1_epi64x(wrap);
+        __m256i pro = _mm256_and_si256(empty, wrap_mask);
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shifted(gen, shift)));
+        pro = _mm256_and_si256(pro, shifted(pro, shift));
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shifted(gen, 2 * shift)));
+        pro = _mm256_and_si256(pro, shifted(pro, 2 * shift));
+        gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shifted(gen, 4 * shift)));
+
+        return _mm256_and_si256(shifted(gen, shift), wrap_mask);
+    };
+
+    const __m256i result = _mm256_or_si256(
+        _mm256_or_si256(fill.template operator()<shift_a, wrap_a>(pieces, empty), fill.template operator()<-shift_a, wrap_a_back>(pieces, empty)),
+        _mm256_or_si256(fill.template operator()<shift_b, wrap_b>(pieces, empty), fill.template operator()<-shift_b, wrap_b_back>(pieces, empty)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(attacks.data()), result);
+#else
+    const u64 empty = ~occupancy;
+
+    for ( int i = 0; i < 4; ++i ) {
+        attacks[i] = directionAttacks<shift_a, wrap_a>(sets[i], empty) | directionAttacks<-shift_a, wrap_a_back>(sets[i], empty)
+            | directionAttacks<shift_b, wrap_b>(sets[i], empty) | directionAttacks<-shift_b, wrap_b_back>(sets[i], empty);
+    }
+#endif
+
+    return attacks;
+}
+
+#if defined(__AVX2__)
+
+/**
+ * @brief   All squares attacked by a set of sliders, AVX2 version.
+ *          Lanes are { N, E, NE, NW } shifted left and { S, W, SW, SE } shifted right,
+ *          so both registers share the shift amounts { 8, 1, 9, 7 }.
+ *
+ * @param diagonal      bishops and queens
+ * @param orthogonal    rooks and queens
+ * @param occupancy     all pieces
+ * @return u64          union of all attacks
+ */
+inline u64 attacksAvx2(u64 diagonal, u64 orthogonal, u64 occupancy)
+{
+    const __m256i shift_1 = _mm256_setr_epi64x(8, 1, 9, 7);
+    const __m256i shift_2 = _mm256_setr_epi64x(16, 2, 18, 14);
+    const __m256i shift_4 = _mm256_setr_epi64x(32, 4, 36, 28);
+
+    const __m256i wrap_l = _mm256_setr_epi64x(FULL_BB, NOT_A, NOT_A, NOT_H);
+    const __m256i wrap_r = _mm256_setr_epi64x(FULL_BB, NOT_H, NOT_H, NOT_A);
+
+    const __m256i empty = _mm256_set1_epi64x(~occupancy);
+    const __m256i pieces = _mm256_setr_epi64x(orthogonal, orthogonal, diagonal, diagonal);
+
+    // left shifts: north, east, north east, north west
+    __m256i gen_l = pieces;
+    __m256i pro_l = _mm256_and_si256(empty, wrap_l);
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(pro_l, _mm256_sllv_epi64(gen_l, shift_1)));
+    pro_l = _mm256_and_si256(pro_l, _mm256_sllv_epi64(pro_l, shift_1));
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(pro_l, _mm256_sllv_epi64(gen_l, shift_2)));
+    pro_l = _mm256_and_si256(pro_l, _mm256_sllv_epi64(pro_l, shift_2));
+    gen_l = _mm256_or_si256(gen_l, _mm256_and_si256(pro_l, _mm256_sllv_epi64(gen_l, shift_4)));
+    const __m256i attacks_l = _mm256_and_si256(_mm256_sllv_epi64(gen_l, shift_1), wrap_l);
+
+    // right shifts: south, west, south west, south east
+    __m256i gen_r = pieces;
+    __m256i pro_r = _mm256_and_si256(empty, wrap_r);
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(pro_r, _mm256_srlv_epi64(gen_r, shift_1)));
+    pro_r = _mm256_and_si256(pro_r, _mm256_srlv_epi64(pro_r, shift_1));
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(pro_r, _mm256_srlv_epi64(gen_r, shift_2)));
+    pro_r = _mm256_and_si256(pro_r, _mm256_srlv_epi64(pro_r, shift_2));
+    gen_r = _mm256_or_si256(gen_r, _mm256_and_si256(pro_r, _mm256_srlv_epi64(gen_r, shift_4)));
+    const __m256i attacks_r = _mm256_and_si256(_mm256_srlv_epi64(gen_r, shift_1), wrap_r);
+
+    // horizontal or of the four lanes
+    const __m256i attacks = _mm256_or_si256(attacks_l, attacks_r);
+    const __m128i half = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+    return static_cast<u64>(_mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1));
+}
+
+#endif
+
+} // namespace kogge_stone
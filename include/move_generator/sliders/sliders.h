@@ -4,11 +4,12 @@
 #include "definitions.h"
 #include "magic/magic.h"
 #include "board/board.h"
+#include "move_generator/serialize.h"
 
 class sliders {
 public:
-    template <PieceType type, Color color>
-    static void generateMoves(MoveList& move_list, const Board& board);
+    template <PieceType type, Color color, GenType gen = GenType::all>
+    static void generateMoves(MoveList& move_list, const Board& board, u64 targets = FULL_BB);
 
     template <PieceType type>
     static inline u64 getBitboard(u64 pieces, u64 occupancy);
@@ -2,13 +2,14 @@
 
 #include "sliders.h"
 
-template <PieceType type, Color color>
-void sliders::generateMoves(MoveList& move_list, const Board& board)
+template <PieceType type, Color color, GenType gen>
+void sliders::generateMoves(MoveList& move_list, const Board& board, u64 targets)
 {
     static_assert(type == PieceType::bishop || type == PieceType::rook || type == PieceType::queen);
 
     const uint64_t occupancy = board.getOccupancy();
-    const uint64_t enemy = board.getEnemy<color>();
+    const uint64_t empty = ~occupancy & targets;
+    const uint64_t enemy = board.getEnemy<color>() & targets;
     uint64_t pieces = board.getPieces<type, color>();
 
     BIT_LOOP(pieces)
@@ -16,18 +17,14 @@ void sliders::generateMoves(MoveList& move_list, const Board& board)
         const uint64_t from = get_LSB(pieces);
         const uint64_t potential_moves = getBitboard<type>((1ULL << from), occupancy);
 
-        uint64_t attacks = potential_moves & enemy;
-        BIT_LOOP(attacks)
-        {
-            const uint64_t to = get_LSB(attacks);
-            move_list.add(Move::make<Move::Flag::capture>(from, to));
+        if constexpr ( gen != GenType::quiets ) {
+            const uint64_t attacks = potential_moves & enemy;
+            serialize::fromSquare<Move::Flag::capture>(move_list, from, attacks);
         }
 
-        uint64_t moves = potential_moves & ~occupancy;
-        BIT_LOOP(moves)
-        {
-            const uint64_t to = get_LSB(moves);
-            move_list.add(Move::make<Move::Flag::quiet>(from, to));
+        if constexpr ( gen != GenType::captures ) {
+            const uint64_t moves = potential_moves & empty;
+            serialize::fromSquare<Move::Flag::quiet>(move_list, from, moves);
         }
     }
 }
@@ -0,0 +1,114 @@
+/**
+ * @file accumulator.h
+ * @brief   The part of the NNUE evaluator that lives in the Board: the accumulators and the piece deltas of each ply.
+ *
+ * Every move pushes an entry with the pieces that movePiece / placePiece / removePiece changed (at most three,
+ * a capturing promotion) and undo pops it again. The accumulators themselves are only computed when an eval needs
+ * them (nnue::evaluate): from the closest computed ply below, by applying the deltas, or from scratch if the king of
+ * that perspective moved in between. See nnue/nnue.h for the network.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "definitions.h"
+
+namespace nnue {
+
+// HalfKP: own king square x (5 piece types x 2 colors, no kings) x piece square, per perspective
+constexpr int INPUT_DIMENSIONS = 64 * 10 * 64;
+constexpr int HALF_DIMENSIONS = 256;
+
+/**
+ * @brief   Pieces changed by one move. from is NO_SQUARE for a placed piece, to is NO_SQUARE for a removed one.
+ */
+struct DirtyPiece {
+    static constexpr uint8_t NO_SQUARE = 64;
+
+    uint8_t count = 0;
+    std::array<Piece, 3> piece {};
+    std::array<uint8_t, 3> from {};
+    std::array<uint8_t, 3> to {};
+
+    inline void add(Piece moved, uint64_t from_square, uint64_t to_square)
+    {
+        piece[count] = moved;
+        from[count] = static_cast<uint8_t>(from_square);
+        to[count] = static_cast<uint8_t>(to_square);
+        ++count;
+    }
+};
+
+struct alignas(64) Accumulator {
+    // feature transformer output of white / black
+    std::array<std::array<int16_t, HALF_DIMENSIONS>, 2> values;
+    std::array<bool, 2> computed = { false, false };
+
+    // what the move into this position changed
+    DirtyPiece dirty;
+};
+
+/**
+ * @brief   One accumulator per ply of the board, the last one belongs to the current position.
+ *          The storage is kept when plies are popped, so a search only allocates while it goes deeper than before.
+ */
+class AccumulatorStack {
+    std::vector<Accumulator> stack;
+    size_t size = 1;
+
+public:
+    AccumulatorStack() : stack(1) { }
+
+    /**
+     * @brief   Start the entry of a new ply, the board fills in its dirty pieces.
+     *
+     * @return DirtyPiece&
+     */
+    inline DirtyPiece& push()
+    {
+        if ( size == stack.size() ) {
+            stack.emplace_back();
+        }
+
+        Accumulator& entry = stack[size++];
+        entry.computed = { false, false };
+        entry.dirty.count = 0;
+
+        return entry.dirty;
+    }
+
+    inline void pop() { --size; }
+
+    // a new position without history, nothing computed
+    inline void reset()
+    {
+        size = 1;
+        stack[0].computed = { false, false };
+    }
+
+    /**
+     * @brief   Only the current ply, for Board::clone. Whatever was not computed will be refreshed.
+     *
+     * @return AccumulatorStack
+     */
+    inline AccumulatorStack cloneTop() const
+    {
+        AccumulatorStack copy;
+        copy.stack[0] = current();
+        copy.stack[0].dirty.count = 0;
+
+        return copy;
+    }
+
+    inline Accumulator& operator[](size_t ply) { return stack[ply]; }
+    inline const Accumulator& current() const { return stack[size - 1]; }
+    inline Accumulator& current() { return stack[size - 1]; }
+
+    // index of the current ply
+    inline size_t top() const { return size - 1; }
+};
+
+} // namespace nnue
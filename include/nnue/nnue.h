@@ -0,0 +1,328 @@
+/**
+ * @file nnue.h
+ * @brief   Optional NNUE evaluator: a HalfKP feature transformer with incrementally updated accumulators
+ *          and three small quantized dense layers, CPU only.
+ *
+ *      2 x 40960 HalfKP inputs -> 2 x 256 (int16 accumulators, one per perspective)
+ *          -> clipped ReLU, side to move first -> 512 x uint8
+ *          -> 32 (int8 weights, int32 sums >> 6, clipped ReLU) -> 32 (same) -> 1
+ *
+ * The dense layers use AVX2 if the build has it (maddubs / madd dot products) and a scalar loop otherwise,
+ * the accumulator updates are plain int16 loops that the compiler vectorizes.
+ *
+ * Weights are mmap'd read only from a file, all threads share the mapping. File layout (little endian):
+ *
+ *      header          64 bytes    "SLOUNNUE", then uint32 version, input, half, l1 and l2 dimensions, zero padding
+ *      ft_bias         int16[256]
+ *      ft_weights      int16[40960][256]
+ *      l1_bias         int32[32]
+ *      l1_weights      int8[32][512]
+ *      l2_bias         int32[32]
+ *      l2_weights      int8[32][32]
+ *      out_weights     int8[32]
+ *      out_bias        int32
+ *
+ * Boards only keep accumulators after Board::setNnue(true), Game turns them on when a network is loaded.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "board/board.h"
+#include "nnue/accumulator.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace nnue {
+
+constexpr int L1_DIMENSIONS = 32;
+constexpr int L2_DIMENSIONS = 32;
+constexpr uint32_t VERSION = 1;
+
+// the dense layers shift their sums back into the uint8 range, the output is scaled down to centipawns
+constexpr int WEIGHT_SHIFT = 6;
+constexpr int OUTPUT_SCALE = 16;
+
+class Network {
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+
+public:
+    // point into the mapping, only valid while isLoaded()
+    const int16_t* ft_bias = nullptr;
+    const int16_t* ft_weights = nullptr;
+    const int32_t* l1_bias = nullptr;
+    const int8_t* l1_weights = nullptr;
+    const int32_t* l2_bias = nullptr;
+    const int8_t* l2_weights = nullptr;
+    const int8_t* out_weights = nullptr;
+    int32_t out_bias = 0;
+
+    Network() = default;
+    Network(const Network&) = delete;
+    Network& operator=(const Network&) = delete;
+    ~Network() { unload(); }
+
+    /**
+     * @brief   Map a network file, replaces the loaded one. Throws a runtime_error if the file can not be mapped
+     *          or does not match the layout above. Accumulators computed with the old network are stale afterwards.
+     *
+     * @param path
+     */
+    void load(const std::string& path);
+    void unload();
+
+    inline bool isLoaded() const { return mapping != nullptr; }
+
+    /**
+     * @brief   Size of a network file, for tools that write one.
+     *
+     * @return size_t
+     */
+    static constexpr size_t fileSize()
+    {
+        return 64 + sizeof(int16_t) * HALF_DIMENSIONS * (1 + static_cast<size_t>(INPUT_DIMENSIONS))
+            + sizeof(int32_t) * L1_DIMENSIONS + L1_DIMENSIONS * 2 * HALF_DIMENSIONS
+            + sizeof(int32_t) * L2_DIMENSIONS + L2_DIMENSIONS * L1_DIMENSIONS
+            + L2_DIMENSIONS + sizeof(int32_t);
+    }
+};
+
+// the network used by every board, loaded once at startup or by the EvalFile option
+extern Network network;
+
+/**
+ * @brief   Input index of a piece, seen from one perspective. Black sees the board mirrored vertically.
+ *
+ * @param perspective
+ * @param king_square   king of the perspective
+ * @param piece         any piece but a king
+ * @param square
+ * @return int
+ */
+constexpr int featureIndex(Color perspective, int king_square, Piece piece, int square)
+{
+    const int flip = utils::isWhite(perspective) ? 0 : 56;
+    const int type = static_cast<int>(utils::getPieceType(piece));
+    const int relative_color = utils::pieceColor(piece) == perspective ? 0 : 1;
+
+    return ((king_square ^ flip) * 10 + type * 2 + relative_color) * 64 + (square ^ flip);
+}
+
+inline void addFeature(std::array<int16_t, HALF_DIMENSIONS>& values, int index)
+{
+    const int16_t* weights = network.ft_weights + static_cast<size_t>(index) * HALF_DIMENSIONS;
+    for ( int i = 0; i < HALF_DIMENSIONS; ++i ) {
+        values[i] += weights[i];
+    }
+}
+
+inline void subFeature(std::array<int16_t, HALF_DIMENSIONS>& values, int index)
+{
+    const int16_t* weights = network.ft_weights + static_cast<size_t>(index) * HALF_DIMENSIONS;
+    for ( int i = 0; i < HALF_DIMENSIONS; ++i ) {
+        values[i] -= weights[i];
+    }
+}
+
+/**
+ * @brief   Compute one perspective of an accumulator from scratch.
+ *
+ * @tparam perspective
+ * @param board
+ * @param accumulator
+ */
+template <Color perspective>
+inline void refresh(const Board& board, Accumulator& accumulator)
+{
+    auto& values = accumulator.values[static_cast<int>(perspective)];
+    std::copy(network.ft_bias, network.ft_bias + HALF_DIMENSIONS, values.begin());
+
+    const u64 king_bb = board.getPieces<PieceType::king, perspective>();
+    const int king_square = get_LSB(king_bb);
+
+    u64 pieces = board.getOccupancy() & ~board.getPieces<PieceType::king, Color::white>() & ~board.getPieces<PieceType::king, Color::black>();
+    BIT_LOOP(pieces)
+    {
+        const int square = get_LSB(pieces);
+        addFeature(values, featureIndex(perspective, king_square, board.getPiece(square), square));
+    }
+
+    accumulator.computed[static_cast<int>(perspective)] = true;
+}
+
+/**
+ * @brief   Compute one perspective of an accumulator from the one of the previous ply and the dirty pieces.
+ *          The king of the perspective must not have moved.
+ *
+ * @tparam perspective
+ * @param previous
+ * @param accumulator
+ * @param king_square   king of the perspective
+ */
+template <Color perspective>
+inline void update(const Accumulator& previous, Accumulator& accumulator, int king_square)
+{
+    const int side = static_cast<int>(perspective);
+    auto& values = accumulator.values[side];
+    values = previous.values[side];
+
+    const DirtyPiece& dirty = accumulator.dirty;
+    for ( int i = 0; i < dirty.count; ++i ) {
+        if ( utils::getPieceType(dirty.piece[i]) == PieceType::king ) {
+            continue;
+        }
+
+        if ( dirty.from[i] != DirtyPiece::NO_SQUARE ) {
+            subFeature(values, featureIndex(perspective, king_square, dirty.piece[i], dirty.from[i]));
+        }
+        if ( dirty.to[i] != DirtyPiece::NO_SQUARE ) {
+            addFeature(values, featureIndex(perspective, king_square, dirty.piece[i], dirty.to[i]));
+        }
+    }
+
+    accumulator.computed[side] = true;
+}
+
+/**
+ * @brief   Bring one perspective of the current accumulator up to date. Walks back to the closest computed ply
+ *          and replays the dirty pieces from there, if the king of the perspective moved on the way (or nothing
+ *          is computed) it refreshes instead.
+ *
+ * @tparam perspective
+ * @param board
+ */
+template <Color perspective>
+inline void updateAccumulator(Board& board)
+{
+    AccumulatorStack& stack = board.getAccumulators();
+    const int side = static_cast<int>(perspective);
+    constexpr Piece king = utils::getPiece(PieceType::king, perspective);
+
+    size_t ply = stack.top();
+    while ( !stack[ply].computed[side] ) {
+        // the moving piece is always recorded first
+        const DirtyPiece& dirty = stack[ply].dirty;
+        const bool king_moved = dirty.count > 0 && dirty.piece[0] == king;
+
+        if ( ply == 0 || king_moved ) {
+            refresh<perspective>(board, stack.current());
+            return;
+        }
+
+        --ply;
+    }
+
+    const u64 king_bb = board.getPieces<PieceType::king, perspective>();
+    const int king_square = get_LSB(king_bb);
+    for ( ++ply; ply <= stack.top(); ++ply ) {
+        update<perspective>(stack[ply - 1], stack[ply], king_square);
+    }
+}
+
+/**
+ * @brief   Fully connected layer on uint8 inputs with int8 weights, the outputs are clipped back to [0, 127].
+ *
+ * @tparam inputs   multiple of 32
+ * @tparam outputs
+ */
+template <int inputs, int outputs>
+inline void affineClipped(const uint8_t* input, const int8_t* weights, const int32_t* bias, uint8_t* output)
+{
+    for ( int o = 0; o < outputs; ++o ) {
+        const int8_t* row = weights + o * inputs;
+        int32_t sum = bias[o];
+
+#if defined(__AVX2__)
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i acc = _mm256_setzero_si256();
+        for ( int i = 0; i < inputs; i += 32 ) {
+            const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+            const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+            // u8 x i8 pairs to i16 (at most 2 * 127 * 127, no saturation), then pairs of i16 to i32
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+        }
+
+        __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+        sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+        sum += _mm_cvtsi128_si32(sum128);
+#else
+        for ( int i = 0; i < inputs; ++i ) {
+            sum += static_cast<int32_t>(input[i]) * row[i];
+        }
+#endif
+
+        output[o] = static_cast<uint8_t>(std::clamp(sum >> WEIGHT_SHIFT, 0, 127));
+    }
+}
+
+/**
+ * @brief   Clipped ReLU of both accumulators, side to move first.
+ *
+ * @param accumulator
+ * @param side_to_move
+ * @param output        2 * HALF_DIMENSIONS bytes
+ */
+inline void transform(const Accumulator& accumulator, Color side_to_move, uint8_t* output)
+{
+    const int order[2] = { static_cast<int>(side_to_move), static_cast<int>(utils::switchColor(side_to_move)) };
+
+    for ( int half = 0; half < 2; ++half ) {
+        const int16_t* values = accumulator.values[order[half]].data();
+        uint8_t* out = output + half * HALF_DIMENSIONS;
+
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        for ( int i = 0; i < HALF_DIMENSIONS; i += 32 ) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 16));
+            // packs saturates to [-128, 127] but interleaves the 128 bit lanes, the permute puts them back in order
+            const __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(a, b), zero);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+        }
+#else
+        for ( int i = 0; i < HALF_DIMENSIONS; ++i ) {
+            out[i] = static_cast<uint8_t>(std::clamp<int>(values[i], 0, 127));
+        }
+#endif
+    }
+}
+
+/**
+ * @brief   Static eval by the network, relative to the side to move. Needs a loaded network and
+ *          a board with Board::setNnue(true).
+ *
+ * @tparam color    side to move
+ * @param board
+ * @return int      centipawns
+ */
+template <Color color>
+inline int evaluate(Board& board)
+{
+    updateAccumulator<Color::white>(board);
+    updateAccumulator<Color::black>(board);
+
+    alignas(64) uint8_t transformed[2 * HALF_DIMENSIONS];
+    alignas(64) uint8_t hidden_1[L1_DIMENSIONS];
+    alignas(64) uint8_t hidden_2[L2_DIMENSIONS];
+
+    transform(board.getAccumulators().current(), color, transformed);
+    affineClipped<2 * HALF_DIMENSIONS, L1_DIMENSIONS>(transformed, network.l1_weights, network.l1_bias, hidden_1);
+    affineClipped<L1_DIMENSIONS, L2_DIMENSIONS>(hidden_1, network.l2_weights, network.l2_bias, hidden_2);
+
+    int32_t output = network.out_bias;
+    for ( int i = 0; i < L2_DIMENSIONS; ++i ) {
+        output += static_cast<int32_t>(hidden_2[i]) * network.out_weights[i];
+    }
+
+    return output / OUTPUT_SCALE;
+}
+
+} // namespace nnue
@@ -0,0 +1,56 @@
+/**
+ * @file pawn_table.h
+ * @brief   Hash table for the pawn structure, indexed by the pawn key (Board::getPawnKey).
+ *
+ * The pawn structure changes only with pawn moves and pawn captures, so nearly every eval finds its entry here.
+ * An entry keeps the pawn score and the bitboards derived from the structure, so the rest of the eval
+ * can read them without computing them again.
+ *
+ * Entries are 32 bytes and not atomic, use one table per searching thread.
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+
+struct PawnEntry {
+    uint64_t key = 0ULL;
+
+    // passed pawns of white / black
+    std::array<u64, 2> passed {};
+
+    // files without a pawn of white / black, bit i is file i
+    std::array<uint8_t, 2> semi_open_files = { 0xFF, 0xFF };
+
+    // pawn structure score from white's view
+    int16_t score = 0;
+
+    // a default entry is the correct entry for a position without pawns, whose pawn key is 0
+};
+
+static_assert(sizeof(PawnEntry) == 32, "two pawn entries per cache line");
+
+template <size_t MB>
+class PawnTable {
+    // a power of two, so the index is a mask of the low bits
+    static constexpr size_t _size = std::bit_floor((MB * 1024 * 1024) / sizeof(PawnEntry));
+
+    std::vector<PawnEntry> table;
+public:
+    PawnTable() : table(_size) { }
+
+    /**
+     * @brief   The slot of a pawn key, the caller compares the key and fills the entry on a miss.
+     *
+     * @param key   pawn key
+     * @return PawnEntry&
+     */
+    inline PawnEntry& operator[](uint64_t key) { return table[key & (_size - 1)]; }
+
+    constexpr size_t size() const { return _size; }
+};
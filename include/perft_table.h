@@ -0,0 +1,174 @@
+/**
+ * @file perft_table.h
+ * @brief   Transposition table for perft, node counts by Zobrist key and depth.
+ *
+ * An entry is 16 bytes:
+ *
+ *      key_depth   the key with the depth in its low byte
+ *      data        the node count in the low 56 bits, the low byte of the key in the top byte
+ *
+ * so the whole key is still compared and a node count up to 2^56 fits. Four entries form a bucket of one
+ * cache line. The same position can be stored at several depths in a bucket, e.g. a transposition reached
+ * with two and with four plies left. A store replaces the entry with the smallest node count, the cheapest
+ * to compute again.
+ *
+ * Entries are not atomic, use one table per thread.
+ *
+ * The table can also live in a file (PerftFile), Zobrist keys are the same in every run, so a later run
+ * starts with every node count of the earlier ones and repeating a perft only costs the lookup of the root.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct PerftEntry {
+    uint64_t key_depth = 0ULL;
+    uint64_t data = 0ULL;
+};
+
+static_assert(sizeof(PerftEntry) == 16, "four perft entries per cache line");
+
+struct alignas(64) PerftBucket {
+    std::array<PerftEntry, 4> entries {};
+};
+
+/**
+ * @brief   A file mapped into memory (MAP_SHARED) that holds a perft table between runs.
+ *
+ * The file starts with a 64 byte header: a magic, the format version, the size of the table and the fingerprint
+ * of the binary that wrote it. If any of them does not match, the table is cleared, so a rebuilt engine
+ * (e.g. with a changed move generator) never trusts node counts it did not compute itself.
+ * One process at a time, entries are written without locks.
+ */
+class PerftFile {
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    bool warm = false;
+public:
+    /**
+     * @brief   Open or create the file and map it, throws a runtime_error if that fails.
+     *
+     * @param path
+     * @param table_size    in bytes
+     * @param fingerprint   see fingerprint()
+     */
+    PerftFile(const std::string& path, size_t table_size, uint64_t fingerprint);
+    ~PerftFile();
+
+    PerftFile(const PerftFile&) = delete;
+    PerftFile& operator=(const PerftFile&) = delete;
+
+    // the table behind the header, aligned to a cache line
+    void* data() const;
+
+    // the file had a table of the same binary, not a cleared one
+    constexpr bool isWarm() const { return warm; }
+
+    /**
+     * @brief   FNV-1a hash of a file, the engine hashes its own binary. Throws a runtime_error if it can not be read.
+     *
+     * @param path
+     * @return uint64_t
+     */
+    static uint64_t fingerprint(const std::string& path);
+};
+
+template <size_t MB>
+class PerftTable {
+    // a power of two, so the index is a mask of the low bits
+    static constexpr size_t _size = std::bit_floor((MB * 1024 * 1024) / sizeof(PerftBucket));
+
+    static constexpr uint64_t DEPTH_MASK = 0xFFULL;
+    static constexpr uint64_t NODE_MASK = (1ULL << 56) - 1;
+
+    // the buckets are in memory, or in the file once one is mapped
+    std::vector<PerftBucket> memory;
+    std::unique_ptr<PerftFile> file;
+    PerftBucket* table;
+public:
+    PerftTable() : memory(_size), table(memory.data()) { }
+
+    /**
+     * @brief   Move the table into a file, see PerftFile. The entries in memory are dropped.
+     *
+     * @param path
+     * @param fingerprint   of the running binary
+     * @return true         if the file already had entries of this binary
+     */
+    bool mapFile(const std::string& path, uint64_t fingerprint)
+    {
+        file = std::make_unique<PerftFile>(path, _size * sizeof(PerftBucket), fingerprint);
+        table = static_cast<PerftBucket*>(file->data());
+        memory = {};
+
+        return file->isWarm();
+    }
+
+    /**
+     * @brief   Look up the node count of a position at a depth.
+     *
+     * @param key       zobrist key of the position
+     * @param depth     remaining depth, 1 to 255
+     * @param nodes     set to the node count on a hit
+     * @return true     on a hit
+     */
+    inline bool probe(uint64_t key, int depth, uint64_t& nodes) const
+    {
+        const uint64_t key_depth = (key & ~DEPTH_MASK) | static_cast<uint64_t>(depth);
+        const uint64_t key_low = (key & DEPTH_MASK) << 56;
+
+        for ( const PerftEntry& entry : table[key & (_size - 1)].entries ) {
+            if ( entry.key_depth == key_depth && (entry.data & ~NODE_MASK) == key_low ) {
+                nodes = entry.data & NODE_MASK;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief   Store the node count of a position at a depth. Counts that do not fit in 56 bits are not stored.
+     *
+     * @param key
+     * @param depth     remaining depth, 1 to 255
+     * @param nodes
+     */
+    inline void store(uint64_t key, int depth, uint64_t nodes)
+    {
+        if ( nodes > NODE_MASK ) {
+            return;
+        }
+
+        const uint64_t key_depth = (key & ~DEPTH_MASK) | static_cast<uint64_t>(depth);
+        const uint64_t data = ((key & DEPTH_MASK) << 56) | nodes;
+
+        // the same position and depth, otherwise the smallest subtree. an empty entry has no nodes at all
+        auto& entries = table[key & (_size - 1)].entries;
+        PerftEntry* replace = &entries[0];
+        for ( PerftEntry& entry : entries ) {
+            if ( entry.key_depth == key_depth ) {
+                replace = &entry;
+                break;
+            }
+
+            if ( (entry.data & NODE_MASK) < (replace->data & NODE_MASK) ) {
+                replace = &entry;
+            }
+        }
+
+        *replace = PerftEntry { key_depth, data };
+    }
+
+    void clear() { std::fill(table, table + _size, PerftBucket {}); }
+
+    // number of entries
+    constexpr size_t size() const { return _size * 4; }
+};
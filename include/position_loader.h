@@ -0,0 +1,73 @@
+/**
+ * @file position_loader.h
+ * @brief   Streams FEN / EPD lines from a file or a buffer into a reusable Board.
+ *
+ * Files are mmap'd and read in place, a line is never copied: the loader hands out string_views into the
+ * mapping and Board::setFen parses them without allocating. Empty lines and lines starting with '#' are skipped.
+ *
+ *      PositionLoader loader("positions.epd");
+ *      Board board;
+ *      while ( loader.next(board) ) {
+ *          use(board, loader.getOperations());
+ *      }
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "board/board.h"
+
+class PositionLoader {
+    std::string_view buffer;
+    size_t offset = 0;
+    size_t count = 0;
+
+    // only set if we mapped a file ourselves
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+
+    std::string_view line;
+    std::string_view operations;
+
+public:
+    /**
+     * @brief   Map a file, throws a runtime_error if it can not be opened or mapped.
+     *
+     * @param path
+     */
+    explicit PositionLoader(const std::string& path);
+
+    /**
+     * @brief   Read from a buffer in memory, it is not copied and has to outlive the loader.
+     *
+     * @param data
+     * @param size
+     */
+    PositionLoader(const char* data, size_t size) : buffer(data, size) { }
+
+    ~PositionLoader();
+
+    PositionLoader(const PositionLoader&) = delete;
+    PositionLoader& operator=(const PositionLoader&) = delete;
+
+    /**
+     * @brief   Load the next position into board.
+     *          A malformed line throws (see Board::setFen), the loader is already past it, so the caller can go on.
+     *
+     * @param board     reused for every position
+     * @return true     if a position was loaded, false at the end of the input
+     */
+    bool next(Board& board);
+
+    // the whole line of the last position
+    constexpr std::string_view getLine() const { return line; }
+
+    // everything after the fen fields, e.g. EPD operations like 'bm Nf3; id "1";' or a game result
+    constexpr std::string_view getOperations() const { return operations; }
+
+    // number of positions loaded so far
+    constexpr size_t getCount() const { return count; }
+};
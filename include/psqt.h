@@ -0,0 +1,169 @@
+/**
+ * @file psqt.h
+ * @brief   Tapered piece square tables: material and position of every piece, for the midgame and the endgame.
+ *
+ * A Score packs a midgame and an endgame value into one int32 (eg in the upper, mg in the lower 16 bits),
+ * so both are summed with a single add. Board keeps the sum over all pieces (white positive) and the game phase
+ * up to date in place / remove / move piece, the eval only interpolates once:
+ *
+ *      score = (mg * phase + eg * (MAX_PHASE - phase)) / MAX_PHASE
+ *
+ * The tables below are written from white's view with rank 8 in the first row, like a diagram. Every piece type
+ * has a midgame and an endgame table, in the layout the tuner prints (tuner::toTables).
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "definitions.h"
+
+using Score = int32_t;
+
+constexpr Score S(int mg, int eg) { return static_cast<Score>(static_cast<uint32_t>(eg) << 16) + mg; }
+
+// the +0x8000 rounds the upper half, a negative mg value borrows one from it
+constexpr int eg_value(Score s) { return static_cast<int16_t>(static_cast<uint32_t>(s + 0x8000) >> 16); }
+constexpr int mg_value(Score s) { return static_cast<int16_t>(static_cast<uint32_t>(s) & 0xFFFF); }
+
+namespace psqt {
+
+// phase weights by Piece, a full board has MAX_PHASE
+constexpr std::array<int, 13> phase_weight = { 0, 1, 1, 2, 4, 0, 0, 1, 1, 2, 4, 0, 0 };
+constexpr int MAX_PHASE = 24;
+
+// by PieceType, the king has no material value, both sides always have one
+constexpr std::array<Score, 7> material = {
+    S(100, 130), S(320, 300), S(320, 310), S(500, 520), S(900, 950), S(0, 0), S(0, 0)
+};
+
+using Table = std::array<int, 64>;
+
+constexpr Table pawn_mg = {
+    0,  0,  0,  0,  0,  0,  0,  0,
+    50, 50, 50, 50, 50, 50, 50, 50,
+    10, 10, 20, 30, 30, 20, 10, 10,
+    5,  5, 10, 25, 25, 10,  5,  5,
+    0, 0,  0, 20, 20,  0,  0,  0,
+    5, -5,-10,  0,  0,-10, -5,  5,
+    5, 10, 10,-20,-20, 10, 10,  5,
+    0, 0, 0, 0, 0, 0, 0, 0
+};
+
+// in the endgame a pawn is worth more the closer it is to promotion
+constexpr Table pawn_eg = {
+    0,  0,  0,  0,  0,  0,  0,  0,
+    80, 80, 80, 80, 80, 80, 80, 80,
+    50, 50, 50, 50, 50, 50, 50, 50,
+    30, 30, 30, 30, 30, 30, 30, 30,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    5,  5,  5,  5,  5,  5,  5,  5,
+    0,  0,  0,  0,  0,  0,  0,  0,
+    0,  0,  0,  0,  0,  0,  0,  0
+};
+
+constexpr Table knight_mg = {
+    -50,-40,-30,-30,-30,-30,-40,-50,
+    -40,-20,  0,  0,  0,  0,-20,-40,
+    -30,  0, 10, 15, 15, 10,  0,-30,
+    -30,  5, 15, 20, 20, 15,  5,-30,
+    -30,  0, 15, 20, 20, 15,  0,-30,
+    -30,  5, 10, 15, 15, 10,  5,-30,
+    -40,-20,  0,  5,  5,  0,-20,-40,
+    -50,-40,-30,-30,-30,-30,-40,-50,
+};
+
+// knights, bishops and queens use the same table in both phases until tuned ones replace them
+constexpr Table knight_eg = knight_mg;
+
+constexpr Table bishop_mg = {
+    -20,-10,-10,-10,-10,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5, 10, 10,  5,  0,-10,
+    -10,  5,  5, 10, 10,  5,  5,-10,
+    -10,  0, 10, 10, 10, 10,  0,-10,
+    -10, 10, 10, 10, 10, 10, 10,-10,
+    -10,  5,  0,  0,  0,  0,  5,-10,
+    -20,-10,-10,-10,-10,-10,-10,-20,
+};
+
+constexpr Table bishop_eg = bishop_mg;
+
+constexpr Table rook_mg = {
+    0,  0,  0,  0,  0,  0,  0,  0,
+    5, 10, 10, 10, 10, 10, 10,  5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    0,  0,  0,  5,  5,  0,  0,  0
+};
+
+constexpr Table rook_eg = {};
+
+constexpr Table queen_mg = {
+    -20,-10,-10, -5, -5,-10,-10,-20,
+    -10,  0,  0,  0,  0,  0,  0,-10,
+    -10,  0,  5,  5,  5,  5,  0,-10,
+    -5,  0,  5,  5,  5,  5,  0, -5,
+    0,  0,  5,  5,  5,  5,  0, -5,
+    -10,  5,  5,  5,  5,  5,  0,-10,
+    -10,  0,  5,  0,  0,  0,  0,-10,
+    -20,-10,-10, -5, -5,-10,-10,-20
+};
+
+constexpr Table queen_eg = queen_mg;
+
+// hide behind the pawns while there are pieces on the board
+constexpr Table king_mg = {
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -30,-40,-40,-50,-50,-40,-40,-30,
+    -20,-30,-30,-40,-40,-30,-30,-20,
+    -10,-20,-20,-20,-20,-20,-20,-10,
+    20, 20,  0,  0,  0,  0, 20, 20,
+    20, 30, 10,  0,  0, 10, 30, 20
+};
+
+// and walk to the center once they are gone
+constexpr Table king_eg = {
+    -50,-40,-30,-20,-20,-30,-40,-50,
+    -30,-20,-10,  0,  0,-10,-20,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 30, 40, 40, 30,-10,-30,
+    -30,-10, 20, 30, 30, 20,-10,-30,
+    -30,-30,  0,  0,  0,  0,-30,-30,
+    -50,-30,-30,-30,-30,-30,-30,-50
+};
+
+/**
+ * @brief   Material plus position of every piece on every square, white positive and black negative.
+ *          White reads the tables upside down (rank 1 is the last row), black reads them as they are.
+ */
+constexpr std::array<std::array<Score, 64>, 12> generateTable()
+{
+    constexpr std::array<const Table*, 6> mg = { &pawn_mg, &knight_mg, &bishop_mg, &rook_mg, &queen_mg, &king_mg };
+    constexpr std::array<const Table*, 6> eg = { &pawn_eg, &knight_eg, &bishop_eg, &rook_eg, &queen_eg, &king_eg };
+
+    std::array<std::array<Score, 64>, 12> table {};
+    for ( int type = 0; type < 6; ++type ) {
+        for ( int square = 0; square < 64; ++square ) {
+            const int white_index = square ^ 56;
+            const int black_index = square;
+
+            table[type][square] = material[type] + S((*mg[type])[white_index], (*eg[type])[white_index]);
+            table[type + 6][square] = -(material[type] + S((*mg[type])[black_index], (*eg[type])[black_index]));
+        }
+    }
+
+    return table;
+}
+
+// indexed by Piece and square
+inline constexpr std::array<std::array<Score, 64>, 12> table = generateTable();
+
+} // namespace psqt
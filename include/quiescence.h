@@ -0,0 +1,86 @@
+/**
+ * @file quiescence.h
+ * @brief   Captures only alpha-beta search that stands pat on the static eval.
+ *
+ * Razoring in Game::minimax uses it to check that a node far below alpha cannot get back by winning material,
+ * the tuner to resolve the captures of a position before it is scored. Both bring their own static eval.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include "definitions.h"
+
+#include "board/board.h"
+#include "board/packed_position.h"
+#include "move.h"
+#include "move_generator/move_picker.h"
+#include "search_stack.h"
+
+/**
+ * @brief   Fail hard quiescence search.
+ *
+ * @tparam color    side to move
+ * @tparam Eval     static eval from the view of the side to move, called as eval.template operator()<color>(board, alpha, beta)
+ * @param board
+ * @param stack     move buffers of this thread
+ * @param ply
+ * @param max_ply   the search stands pat from this ply on
+ * @param alpha
+ * @param beta
+ * @param eval
+ * @param leaf      if not null, set to the position at the end of the principal variation
+ * @return double   within [alpha, beta]
+ */
+template <Color color, typename Eval>
+double quiescence(Board& board, SearchStack& stack, int ply, int max_ply, double alpha, double beta, Eval& eval,
+    PackedPosition* leaf = nullptr)
+{
+    const double stand_pat = eval.template operator()<color>(board, alpha, beta);
+    if ( stand_pat >= beta || ply >= max_ply ) {
+        if ( leaf ) {
+            *leaf = board.pack();
+        }
+
+        return std::clamp(stand_pat, alpha, beta);
+    }
+
+    alpha = std::max(alpha, stand_pat);
+
+    // the picker hands out the captures first and in MVV-LVA order, we stop once it moves on to the quiet stages.
+    // in check it would generate evasions instead, those positions are left to the stand pat
+    MovePicker<color> picker(board, Move(), stack[ply]);
+    PackedPosition child_leaf;
+    bool leaf_is_child = false;
+    if ( !picker.inCheck() ) {
+        for ( Move move = picker.next(); picker.getStage() == MovePicker<color>::Stage::captures; move = picker.next() ) {
+            if ( !board.isLegal<color>(move) ) {
+                continue;
+            }
+
+            board.move<color>(move);
+            const double score = -quiescence<utils::switchColor(color)>(board, stack, ply + 1, max_ply, -beta, -alpha, eval,
+                leaf ? &child_leaf : nullptr);
+            board.undo<color>(move);
+
+            if ( score > alpha ) {
+                alpha = score;
+                leaf_is_child = true;
+                if ( leaf ) {
+                    *leaf = child_leaf;
+                }
+
+                if ( alpha >= beta ) {
+                    return beta;
+                }
+            }
+        }
+    }
+
+    if ( leaf && !leaf_is_child ) {
+        *leaf = board.pack();
+    }
+
+    return alpha;
+}
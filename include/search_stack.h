@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "move.h"
+#include "config.h"
+
+/**
+ * @brief   Everything the search needs for a single ply.
+ *          The move buffer and the scores are left uninitialized, the move generator
+ *          and the move picker always write before they read.
+ */
+struct SearchFrame {
+    MoveList moves;
+    std::array<int, 256> scores;
+
+    // quiet moves that caused a beta cutoff in a sibling node
+    std::array<Move, 2> killers {};
+
+    double static_eval = 0.0;
+
+    // triangular pv, the line from this ply on
+    std::array<Move, MAX_PLY> pv;
+    int pv_length = 0;
+};
+
+/**
+ * @brief   Preallocated per ply frames, one stack per searching thread.
+ *          Recursion reuses the frames, so a node neither zeroes a move list nor grows the call stack by it.
+ *          Perft indexes by the remaining depth, the search by ply.
+ */
+class SearchStack {
+    std::vector<SearchFrame> frames;
+public:
+    SearchStack() : frames(MAX_PLY + 1) { }
+
+    inline SearchFrame& operator[](int ply) { return frames[ply]; }
+    inline const SearchFrame& operator[](int ply) const { return frames[ply]; }
+
+    /**
+     * @brief   Set the pv of this ply to move followed by the pv of the next ply.
+     *
+     * @param ply
+     * @param move  the new best move at this ply
+     */
+    inline void updatePv(int ply, const Move& move)
+    {
+        SearchFrame& frame = frames[ply];
+        const SearchFrame& child = frames[ply + 1];
+
+        frame.pv[0] = move;
+        for ( int i = 0; i < child.pv_length && i + 1 < MAX_PLY; ++i ) {
+            frame.pv[i + 1] = child.pv[i];
+        }
+
+        frame.pv_length = std::min(child.pv_length + 1, MAX_PLY);
+    }
+};
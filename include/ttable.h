@@ -2,12 +2,6 @@
 #include <array>
 #include "move.h"
 
-struct TTEntry_perft {
-    uint64_t key = 0;
-    uint64_t node_count = 0;
-    int depth_searched = 0;
-};
-
 struct TTEntry_eval {
     uint64_t key = 0;
     int depth_searched = 0;
@@ -31,19 +25,6 @@ public:
         table[index] = Entry { key, std::forward<Args>(args)... };
     }
 
-    inline bool if_has_get(uint64_t key, int depth, uint64_t& nodes)
-    {
-        const uint64_t index = getIdx(key);
-        const auto entry = table[index];
-        if ( entry.key == key && entry.depth_searched == depth ) {
-            nodes = entry.node_count;
-            return true;
-        }
-        else {
-            return false;
-        }
-    }
-
     inline bool has(uint64_t key, int depth) const
     {
         const uint64_t index = getIdx(key);
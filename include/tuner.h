@@ -0,0 +1,104 @@
+/**
+ * @file tuner.h
+ * @brief   Texel tuning of the tapered piece square tables (psqt.h) against game results.
+ *
+ * Every position of a labelled EPD / FEN file is first resolved to a quiet position with a captures only
+ * quiescence search, the tuner then minimises the mean squared error between the game result and
+ *
+ *      sigmoid(eval) = 1 / (1 + 10^(-K * eval / 400))
+ *
+ * over all positions with Adam. The eval is the one of evalPosition, only with floating point parameters:
+ * for every piece type and square a midgame and an endgame value (material included), tapered by the phase.
+ * The other terms are not tuned, they are computed once per position and added as a constant.
+ * K is fitted to the untuned parameters first, so the tuner does not just rescale the eval.
+ *
+ * The positions stay packed in memory (32 bytes, plus 3 bytes for the result and the constant terms), so tens of millions fit.
+ * Resolving and every iteration are spread over threads. The result of a line is looked for anywhere after
+ * the fen: "1-0", "0-1", "1/2-1/2" or a score from white's view in brackets ("[1.0]", "[0.5]", "[0]").
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "board/packed_position.h"
+
+namespace tuner {
+
+// midgame and endgame value for every piece type and square, in the diagram order of the tables in psqt.h
+constexpr int PARAMETER_COUNT = 6 * 64 * 2;
+
+using Parameters = std::vector<double>;
+
+struct Dataset {
+    std::vector<PackedPosition> positions;
+    // in half points for white: 0 loss, 1 draw, 2 win
+    std::vector<uint8_t> results;
+    // the terms that are not tuned (pawn structure, mobility, king safety) from white's view, fixed after the quiescence search
+    std::vector<int16_t> fixed_scores;
+
+    inline size_t size() const { return positions.size(); }
+};
+
+/**
+ * @brief   Load a labelled file and replace every position by the quiet leaf of its quiescence search.
+ *          Lines that are malformed or have no result are skipped and counted.
+ *
+ * @param path
+ * @param threads   0 for all hardware threads
+ * @return Dataset
+ */
+Dataset load(const std::string& path, unsigned threads = 0);
+
+/**
+ * @brief   The values the engine uses right now (psqt::material plus the tables of psqt.h).
+ *
+ * @return Parameters
+ */
+Parameters currentParameters();
+
+/**
+ * @brief   The K that minimises the error of the given parameters.
+ *
+ * @param data
+ * @param parameters
+ * @param threads
+ * @return double
+ */
+double fitScalingConstant(const Dataset& data, const Parameters& parameters, unsigned threads = 0);
+
+/**
+ * @brief   Mean squared error of the parameters over the dataset.
+ *
+ * @param data
+ * @param parameters
+ * @param k
+ * @param threads
+ * @return double
+ */
+double error(const Dataset& data, const Parameters& parameters, double k, unsigned threads = 0);
+
+/**
+ * @brief   Run Adam for a number of full passes over the dataset, prints the error and the throughput of every iteration.
+ *
+ * @param data
+ * @param parameters    updated in place
+ * @param k
+ * @param iterations
+ * @param learning_rate in centipawns per step
+ * @param threads
+ */
+void tune(const Dataset& data, Parameters& parameters, double k, int iterations, double learning_rate = 1.0, unsigned threads = 0);
+
+/**
+ * @brief   The parameters as C++ tables in the layout of psqt.h: material by piece type
+ *          (the average over the squares a piece can stand on) and the tables without it.
+ *
+ * @param parameters
+ * @return std::string
+ */
+std::string toTables(const Parameters& parameters);
+
+} // namespace tuner
@@ -2,8 +2,6 @@
 
 #include <array>
 #include <cstdint>
-#include <unordered_map>
-#include <random>
 
 #include "definitions.h"
 
@@ -11,56 +9,86 @@ class Board; // fwd declaration
 
 constexpr int kNumSquares = 64;
 constexpr int kNumPieces = 12;
-constexpr int kNumCastling = 4;
+constexpr int kNumCastling = 16;    // one key per combination of the 4 castling rights
 namespace Zobrist {
-    extern std::array<std::array<uint64_t, kNumSquares>, kNumPieces> pieceKeys;
-    extern uint64_t blackToMove;
-    extern std::array<uint64_t, kNumCastling> castlingKeys;
-    extern std::array<uint64_t, kNumSquares> enPassantKeys;
-    extern std::unordered_map<uint64_t, uint64_t> table;
+    /**
+     * @brief   splitmix64, a tiny PRNG that works in constant expressions.
+     *          The keys only depend on the seed, so hashes are the same on every run and every machine
+     *          and can be stored (TT, opening data) or compared between processes.
+     */
+    constexpr uint64_t splitmix64(uint64_t& seed)
+    {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
 
-    inline char last_castling_rights;
+    struct Keys {
+        std::array<std::array<uint64_t, kNumSquares>, kNumPieces> piece {};
+        std::array<uint64_t, kNumCastling> castling {};
+        std::array<uint64_t, kNumSquares> en_passant {};
+        uint64_t black_to_move = 0ULL;
+    };
 
-    void initialize();
-    uint64_t computeHash(const Board& board);
+    constexpr Keys generateKeys(uint64_t seed)
+    {
+        Keys keys;
 
-    inline void togglePiece(uint64_t& hash, int piece_id, int square) { hash ^= pieceKeys[piece_id][square]; }
+        for ( auto& piece_keys : keys.piece ) {
+            for ( auto& key : piece_keys ) {
+                key = splitmix64(seed);
+            }
+        }
 
-    template <Color color>
-    constexpr void toggleCastling(uint64_t& hash)
-    {
-        if constexpr ( utils::isWhite(color) ) {
-            hash ^= castlingKeys[0];
-            hash ^= castlingKeys[1];
+        keys.black_to_move = splitmix64(seed);
+
+        // indexed by the raw castling rights (bits Q, K, q, k), a combination is the xor of its single rights
+        std::array<uint64_t, 4> single_rights {};
+        for ( auto& key : single_rights ) {
+            key = splitmix64(seed);
         }
-        else {
-            hash ^= castlingKeys[2];
-            hash ^= castlingKeys[3];
+
+        for ( int rights = 0; rights < kNumCastling; ++rights ) {
+            for ( int i = 0; i < 4; ++i ) {
+                if ( rights & (1 << i) ) {
+                    keys.castling[rights] ^= single_rights[i];
+                }
+            }
+        }
+
+        for ( auto& key : keys.en_passant ) {
+            key = splitmix64(seed);
         }
+
+        return keys;
     }
 
-    template <Color color>
-    constexpr void toggleCastlingQs(uint64_t& hash)
+    inline constexpr Keys keys = generateKeys(0x5EED'C0FF'EE00'0001ULL);
+
+    inline constexpr const auto& pieceKeys = keys.piece;
+    inline constexpr const auto& castlingKeys = keys.castling;
+    inline constexpr const auto& enPassantKeys = keys.en_passant;
+    inline constexpr uint64_t blackToMove = keys.black_to_move;
+
+    uint64_t computeHash(const Board& board);
+    uint64_t computePawnHash(const Board& board);
+
+    inline void togglePiece(uint64_t& hash, int piece_id, int square) { hash ^= pieceKeys[piece_id][square]; }
+
+    /**
+     * @brief   Swaps the key of the old castling rights for the key of the new ones.
+     */
+    inline void updateCastling(uint64_t& hash, char old_rights, char new_rights)
     {
-        if constexpr ( utils::isWhite(color) ) {
-            hash ^= castlingKeys[1];
-        }
-        else {
-            hash ^= castlingKeys[3];
-        }
+        hash ^= castlingKeys[old_rights & 0xF] ^ castlingKeys[new_rights & 0xF];
     }
 
-    template <Color color>
-    constexpr void toggleCastlingKs(uint64_t& hash)
+    inline void toggleEnPassant(uint64_t& hash, uint64_t ep_field)
     {
-        if constexpr ( utils::isWhite(color) ) {
-            hash ^= castlingKeys[0];
-        }
-        else {
-            hash ^= castlingKeys[2];
+        if ( ep_field != 0ULL ) {
+            hash ^= enPassantKeys[get_LSB(ep_field)];
         }
     }
-
-    inline void toggleEnPassant(uint64_t& hash, uint64_t ep_field) { hash ^= enPassantKeys[get_LSB(ep_field)]; }
     inline void toggleBlackToMove(uint64_t& hash) { hash ^= blackToMove; }
 };
@@ -6,4 +6,10 @@ DEPTH=$1
 shift
 REST=$@
 
-"${SCRIPT_DIR}/bin/slou" -debug "$DEPTH" "$REST"
\ No newline at end of file
+# set PERFT_CACHE to a file to keep the perft tables between runs (see -perftcache)
+CACHE_ARGS=()
+if [ -n "$PERFT_CACHE" ]; then
+    CACHE_ARGS=(-perftcache "$PERFT_CACHE")
+fi
+
+"${SCRIPT_DIR}/bin/slou" "${CACHE_ARGS[@]}" -debug "$DEPTH" "$REST"
\ No newline at end of file
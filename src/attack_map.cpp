@@ -0,0 +1,97 @@
+#include "board/attack_map.h"
+#include "board/board.h"
+#include "move_generator/move_generation.h"
+
+void AttackMap::init(const Board& board)
+{
+    attacks_from.fill(0ULL);
+    counts[0].fill(0);
+    counts[1].fill(0);
+    attacked.fill(0ULL);
+    sources.fill(0ULL);
+
+    u64 occupancy = board.getOccupancy();
+    BIT_LOOP(occupancy)
+    {
+        addSource(board, get_LSB(occupancy));
+    }
+}
+
+void AttackMap::update(const Board& board, u64 changed)
+{
+    u64 dirty = changed;
+
+    // sliders that did not move but see a changed square, their rays got longer or shorter
+    u64 sliders = ~changed & (board.getPieces<PieceType::bishop, Color::white>() | board.getPieces<PieceType::bishop, Color::black>()
+        | board.getPieces<PieceType::rook, Color::white>() | board.getPieces<PieceType::rook, Color::black>()
+        | board.getPieces<PieceType::queen, Color::white>() | board.getPieces<PieceType::queen, Color::black>());
+
+    BIT_LOOP(sliders)
+    {
+        const int square = get_LSB(sliders);
+        if ( attacks_from[square] & changed ) {
+            dirty |= single_bit_u64(square);
+        }
+    }
+
+    const u64 occupancy = board.getOccupancy();
+    BIT_LOOP(dirty)
+    {
+        const int square = get_LSB(dirty);
+        removeSource(square);
+
+        if ( occupancy & single_bit_u64(square) ) {
+            addSource(board, square);
+        }
+    }
+}
+
+void AttackMap::addSource(const Board& board, int square)
+{
+    const u64 square_mask = single_bit_u64(square);
+    const u64 occupancy = board.getOccupancy();
+    const Piece piece = board.getPiece(square);
+    const int color_index = utils::isWhite(piece) ? 0 : 1;
+
+    u64 attacks = 0ULL;
+    switch ( utils::getPieceType(piece) ) {
+        case PieceType::pawn: attacks = color_index == 0 ? white_pawn_attacks[square] : black_pawn_attacks[square]; break;
+        case PieceType::knight: attacks = knight_attacks[square]; break;
+        case PieceType::bishop: attacks = sliders::getBitboard<PieceType::bishop>(square_mask, occupancy); break;
+        case PieceType::rook: attacks = sliders::getBitboard<PieceType::rook>(square_mask, occupancy); break;
+        case PieceType::queen: attacks = sliders::getBitboard<PieceType::queen>(square_mask, occupancy); break;
+        case PieceType::king: attacks = king_attacks[square]; break;
+        default: return;
+    }
+
+    attacks_from[square] = attacks;
+    sources[color_index] |= square_mask;
+    attacked[color_index] |= attacks;
+
+    BIT_LOOP(attacks)
+    {
+        ++counts[color_index][get_LSB(attacks)];
+    }
+}
+
+void AttackMap::removeSource(int square)
+{
+    const u64 square_mask = single_bit_u64(square);
+    if ( !((sources[0] | sources[1]) & square_mask) ) {
+        return;
+    }
+
+    const int color_index = (sources[0] & square_mask) ? 0 : 1;
+    u64 attacks = attacks_from[square];
+
+    attacks_from[square] = 0ULL;
+    sources[color_index] &= ~square_mask;
+
+    BIT_LOOP(attacks)
+    {
+        const int target = get_LSB(attacks);
+        if ( --counts[color_index][target] == 0 ) {
+            attacked[color_index] &= ~single_bit_u64(target);
+        }
+    }
+}
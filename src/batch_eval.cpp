@@ -0,0 +1,228 @@
+#include "batch_eval.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bitboard.h"
+#include "definitions.h"
+#include "eval.h"
+#include "psqt.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace batch_eval {
+
+namespace {
+
+constexpr int NO_PIECE = static_cast<int>(Piece::none);
+
+// psqt::table by square first, with a zero entry for an empty square, so one square of a chunk is a single gather
+constexpr std::array<std::array<Score, 16>, 64> generateSquareTable()
+{
+    std::array<std::array<Score, 16>, 64> table {};
+    for ( int square = 0; square < 64; ++square ) {
+        for ( int piece = 0; piece < NO_PIECE; ++piece ) {
+            table[square][piece] = psqt::table[piece][square];
+        }
+    }
+
+    return table;
+}
+
+alignas(64) constexpr std::array<std::array<Score, 16>, 64> square_table = generateSquareTable();
+
+struct alignas(64) Chunk {
+    // Piece of every square, position index innermost
+    std::array<std::array<uint8_t, CHUNK_SIZE>, 64> mailbox;
+    // by Piece
+    std::array<std::array<u64, CHUNK_SIZE>, 12> pieces;
+    std::array<bool, CHUNK_SIZE> black_to_move;
+
+    std::array<Score, CHUNK_SIZE> psqt;
+    std::array<int, CHUNK_SIZE> phase;
+    std::array<int, CHUNK_SIZE> pawns;
+};
+
+// the positions have been checked by evaluate, so every nibble is a piece and there are at most 32 of them
+void decode(std::span<const PackedPosition> positions, Chunk& chunk)
+{
+    std::memset(chunk.mailbox.data(), NO_PIECE, sizeof(chunk.mailbox));
+    std::memset(chunk.pieces.data(), 0, sizeof(chunk.pieces));
+
+    for ( size_t i = 0; i < positions.size(); ++i ) {
+        const PackedPosition& packed = positions[i];
+
+        u64 occupancy = packed.occupancy;
+        for ( int n = 0; occupancy != 0ULL; ++n ) {
+            const int square = pop_LSB(occupancy);
+            const int piece = static_cast<int>((packed.pieces[n >> 4] >> ((n & 15) * 4)) & 0xF);
+
+            chunk.mailbox[square][i] = static_cast<uint8_t>(piece);
+            chunk.pieces[piece][i] |= single_bit_u64(square);
+        }
+
+        chunk.black_to_move[i] = packed.flags & 1;
+    }
+}
+
+// sum of the piece square scores, count has to be a multiple of 8 (the unused positions are empty boards)
+void sumPsqt(Chunk& chunk, size_t count)
+{
+    std::fill(chunk.psqt.begin(), chunk.psqt.end(), 0);
+
+    for ( int square = 0; square < 64; ++square ) {
+        const Score* base = square_table[square].data();
+        const uint8_t* pieces = chunk.mailbox[square].data();
+
+#if defined(__AVX2__)
+        for ( size_t i = 0; i < count; i += 8 ) {
+            const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pieces + i)));
+            const __m256i scores = _mm256_i32gather_epi32(base, index, sizeof(Score));
+
+            __m256i* acc = reinterpret_cast<__m256i*>(chunk.psqt.data() + i);
+            _mm256_storeu_si256(acc, _mm256_add_epi32(_mm256_loadu_si256(acc), scores));
+        }
+#else
+        for ( size_t i = 0; i < count; ++i ) {
+            chunk.psqt[i] += base[pieces[i]];
+        }
+#endif
+    }
+}
+
+void countPhase(Chunk& chunk)
+{
+    std::fill(chunk.phase.begin(), chunk.phase.end(), 0);
+
+    for ( int piece = 0; piece < NO_PIECE; ++piece ) {
+        const int weight = psqt::phase_weight[piece];
+        if ( weight == 0 ) {
+            continue;
+        }
+
+        for ( size_t i = 0; i < CHUNK_SIZE; ++i ) {
+            chunk.phase[i] += weight * std::popcount(chunk.pieces[piece][i]);
+        }
+    }
+}
+
+// same as getPawnScore: minus the doubled white pawns, plus the doubled black ones
+void countDoubledPawns(Chunk& chunk)
+{
+    std::fill(chunk.pawns.begin(), chunk.pawns.end(), 0);
+
+    const auto& white_pawns = chunk.pieces[static_cast<int>(Piece::P)];
+    const auto& black_pawns = chunk.pieces[static_cast<int>(Piece::p)];
+
+    for ( int file = 0; file < 8; ++file ) {
+        const u64 file_mask = FILE_A << file;
+
+        for ( size_t i = 0; i < CHUNK_SIZE; ++i ) {
+            const int white = std::popcount(white_pawns[i] & file_mask);
+            const int black = std::popcount(black_pawns[i] & file_mask);
+
+            chunk.pawns[i] -= (white > 1 ? white : 0) - (black > 1 ? black : 0);
+        }
+    }
+}
+
+// one position of a chunk with the piece getters of a Board, for evalActivity
+struct ChunkPosition {
+    const Chunk& chunk;
+    size_t i;
+
+    template <PieceType type, Color color>
+    constexpr u64 getPieces() const { return chunk.pieces[static_cast<int>(utils::getPiece(type, color))][i]; }
+
+    constexpr u64 getOccupancy() const
+    {
+        u64 occupancy = 0ULL;
+        for ( int piece = 0; piece < NO_PIECE; ++piece ) {
+            occupancy |= chunk.pieces[piece][i];
+        }
+
+        return occupancy;
+    }
+};
+
+void evaluateChunk(std::span<const PackedPosition> positions, double* scores, Chunk& chunk)
+{
+    decode(positions, chunk);
+    sumPsqt(chunk, (positions.size() + 7) & ~size_t(7));
+    countPhase(chunk);
+    countDoubledPawns(chunk);
+
+    for ( size_t i = 0; i < positions.size(); ++i ) {
+        // mobility and king safety are not vectorized over the chunk, the slider fills already run in SIMD lanes per position
+        const Score psqt_score = chunk.psqt[i] + evalActivity(ChunkPosition { chunk, i });
+
+        // the same interpolation as evalPosition, promotions can push the phase above the maximum
+        const int phase = std::min(chunk.phase[i], psqt::MAX_PHASE);
+        const int tapered = (mg_value(psqt_score) * phase + eg_value(psqt_score) * (psqt::MAX_PHASE - phase)) / psqt::MAX_PHASE;
+
+        const double score = tapered + chunk.pawns[i];
+        scores[i] = chunk.black_to_move[i] ? -score : score;
+    }
+}
+
+} // namespace
+
+void evaluate(std::span<const PackedPosition> positions, std::span<double> scores, unsigned threads)
+{
+    // before any thread starts, an exception in a worker would terminate the process
+    if ( scores.size() < positions.size() ) {
+        throw std::runtime_error("batch eval needs a score for each of the " + std::to_string(positions.size()) + " positions");
+    }
+
+    for ( size_t i = 0; i < positions.size(); ++i ) {
+        if ( !positions[i].isValid() ) {
+            throw std::runtime_error("invalid packed position at index " + std::to_string(i));
+        }
+    }
+
+    const size_t chunks = (positions.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if ( threads == 0 ) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, chunks));
+
+    // chunks are handed out one by one, so a slow thread does not hold up the others
+    std::atomic<size_t> next_chunk = 0;
+    auto worker = [&]() {
+        Chunk chunk;
+        for ( size_t c = next_chunk++; c < chunks; c = next_chunk++ ) {
+            const size_t begin = c * CHUNK_SIZE;
+            const size_t count = std::min(CHUNK_SIZE, positions.size() - begin);
+            evaluateChunk(positions.subspan(begin, count), scores.data() + begin, chunk);
+        }
+    };
+
+    if ( threads <= 1 ) {
+        worker();
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for ( unsigned t = 1; t < threads; ++t ) {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for ( auto& thread : pool ) {
+        thread.join();
+    }
+}
+
+} // namespace batch_eval
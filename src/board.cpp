@@ -1,38 +1,78 @@
 #include "board/board.h"
 #include "board/board.hpp"
-#include <sstream>
+#include <charconv>
+#include <limits>
 
-Board::Board(const std::string& fen)
+Board::Board(std::string_view fen)
 {
-    state = new State();
+    setFen(fen);
+    setAttackMap(ENABLE_ATTACK_MAP);
+}
 
-    state->ep_field = 0ULL;
+void Board::clear()
+{
+    state.pieces.fill(0ULL);
+    state.mailbox.fill(Piece::none);
+    state.castling_rights.raw = 0x0F;
+    state.cur_color = Color::white;
+    state.zobrist_hash = 0ULL;
+    state.pawn_hash = 0ULL;
+    state.psqt = 0;
+    state.phase = 0;
+    state.ep_field = 0ULL;
+    state.half_move_clock = 0;
+    state.full_move_clock = 1;
 
-    std::string board_fen = fen.substr(0, fen.find_first_of(' '));
-    unsigned index = 0;
-    int rank = 7;
-    int file = 0;
+    key_count = 0;
+
+    if ( accumulators ) {
+        accumulators->reset();
+    }
+
+    // popping keeps the storage of the deque, assigning a new stack would allocate
+    while ( !move_history.empty() ) {
+        move_history.pop();
+    }
+}
+
+size_t Board::setFen(std::string_view fen)
+{
+    clear();
 
-    while ( rank >= 0 ) {
-        if ( index >= board_fen.size() ) {
-            break;
+    size_t pos = 0;
+    auto isBlank = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+    auto nextField = [&]() {
+        while ( pos < fen.size() && isBlank(fen[pos]) ) {
+            ++pos;
         }
 
-        char c = board_fen[index];
+        const size_t begin = pos;
+        while ( pos < fen.size() && !isBlank(fen[pos]) ) {
+            ++pos;
+        }
+
+        return fen.substr(begin, pos - begin);
+    };
+    auto fail = [&](const char* what) {
+        throw std::runtime_error(std::string("invalid fen (") + what + "): " + std::string(fen));
+    };
 
+    // piece placement, placePiece already xors the piece keys into the hash
+    int rank = 7;
+    int file = 0;
+    for ( const char c : nextField() ) {
         if ( c == '/' ) {
-            // next rank
-            rank--;
+            --rank;
             file = 0;
-            index++;
         }
-        else if ( isdigit(c) ) {
-            // skip empty squares
+        else if ( '1' <= c && c <= '8' ) {
             file += c - '0';
-            index++;
         }
         else {
-            // place a piece
+            if ( rank < 0 || file > 7 ) {
+                fail("placement");
+            }
+
             const int square = (rank * 8) + file;
             const Piece piece = utils::getPiece(c);
             if ( utils::isWhite(piece) ) {
@@ -42,67 +82,109 @@ Board::Board(const std::string& fen)
                 placePiece<Color::black>(piece, square);
             }
 
-            state->mailbox[square] = piece;
+            ++file;
+        }
+    }
+
+    // every board has to fit into a PackedPosition, and the eval and the move generator expect exactly one king per side
+    if ( get_bit_count(getOccupancy()) > PackedPosition::MAX_PIECES ) {
+        fail("more than 32 pieces");
+    }
+
+    const u64 white_kings = getPieces<PieceType::king, Color::white>();
+    const u64 black_kings = getPieces<PieceType::king, Color::black>();
+    if ( get_bit_count(white_kings) != 1 || get_bit_count(black_kings) != 1 ) {
+        fail("kings");
+    }
 
-            file++;
-            index++;
+    // active color
+    const std::string_view color = nextField();
+    if ( color == "w" ) {
+        state.cur_color = Color::white;
+    }
+    else if ( color == "b" ) {
+        state.cur_color = Color::black;
+        Zobrist::toggleBlackToMove(state.zobrist_hash);
+    }
+    else {
+        fail("color");
+    }
+
+    // castling rights
+    state.castling_rights.raw = 0x00;
+    for ( const char c : nextField() ) {
+        switch ( c ) {
+            case 'K': state.castling_rights.white_ks = 1; break;
+            case 'Q': state.castling_rights.white_qs = 1; break;
+            case 'k': state.castling_rights.black_ks = 1; break;
+            case 'q': state.castling_rights.black_qs = 1; break;
+            case '-': break;
+            default: fail("castling");
         }
     }
+    Zobrist::updateCastling(state.zobrist_hash, 0x00, state.castling_rights.raw);
+
+    // ep target
+    const std::string_view ep = nextField();
+    if ( ep != "-" ) {
+        const int square = utils::coordinateToIndex(ep);
+        if ( square >= 64 ) {
+            fail("en passant");
+        }
+
+        state.ep_field = single_bit_u64(square);
+        Zobrist::toggleEnPassant(state.zobrist_hash, state.ep_field);
+    }
 
-    std::string rest_fen = fen.substr(fen.find_first_of(' ') + 1);
-    std::istringstream iss(rest_fen);
-    std::string token;
-    int part = 0;
-    while ( iss >> token ) {
-        switch ( part ) {
-            case 0: { // active color
-                if ( token == "w" ) {
-                    state->cur_color = Color::white;
-                }
-                else if ( token == "b" ) {
-                    state->cur_color = Color::black;
-                }
-                else {
-                    assert(false && "COLOR NOT ALLOWED");
-                }
-            } break;
-            case 1: { // castling rights
-                if ( token == "-" ) {
-                    state->castling_rights.raw = 0x00;
-                    break;
-                }
-
-                if ( token.find('K') == std::string::npos )
-                    state->castling_rights.white_ks = 0;
-                if ( token.find('Q') == std::string::npos )
-                    state->castling_rights.white_qs = 0;
-                if ( token.find('k') == std::string::npos )
-                    state->castling_rights.black_ks = 0;
-                if ( token.find('q') == std::string::npos )
-                    state->castling_rights.black_qs = 0;
-            } break;
-            case 2: { // ep target
-                if ( token != "-" ) {
-                    int square = utils::coordinateToIndex(token);
-                    state->ep_field = single_bit_u64(square);
-                }
-                else {
-                    state->ep_field = 0ULL;
-                }
-
-            } break;
-            case 3: { // Halfmove clock
-                // Handle halfmove clock
-            } break;
-            case 4: { // Fullmove number
-                // Handle fullmove number
-            } break;
+    // the clocks are optional, EPD lines continue with operations instead. a clock has to fit into a PackedPosition
+    auto parseClock = [&](int& clock, int max) {
+        const size_t begin = pos;
+        const std::string_view field = nextField();
+        int value = 0;
+        const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+        if ( field.empty() || error != std::errc() || end != field.data() + field.size() ) {
+            pos = begin;
+            return false;
         }
 
-        ++part;
+        if ( value < 0 || value > max ) {
+            fail("clock out of range");
+        }
+
+        clock = value;
+        return true;
+    };
+
+    if ( parseClock(state.half_move_clock, std::numeric_limits<decltype(PackedPosition::half_move)>::max()) ) {
+        parseClock(state.full_move_clock, std::numeric_limits<decltype(PackedPosition::full_move)>::max());
+    }
+
+    if ( attack_map ) {
+        attack_map->init(*this);
+    }
+
+    return pos;
+}
+
+void Board::setAttackMap(bool enabled)
+{
+    if ( !enabled ) {
+        attack_map.reset();
+        return;
+    }
+
+    attack_map.emplace();
+    attack_map->init(*this);
+}
+
+void Board::setNnue(bool enabled)
+{
+    if ( !enabled ) {
+        accumulators.reset();
+        return;
     }
 
-    state->zobrist_hash = Zobrist::computeHash(*this);
+    accumulators.emplace();
 }
 
 std::string Board::getFen() const
@@ -112,7 +194,7 @@ std::string Board::getFen() const
     for ( int j = 7; j >= 0; --j ) {
         int counter = 0;
         for ( unsigned i = 0; i < 8; ) {
-            while ( state->mailbox[(j * 8) + i] == Piece::none && i < 8 ) {
+            while ( state.mailbox[(j * 8) + i] == Piece::none && i < 8 ) {
                 ++counter;
                 ++i;
             }
@@ -122,7 +204,7 @@ std::string Board::getFen() const
                 counter = 0;
             }
             else {
-                res += utils::PieceToChar(state->mailbox[(j * 8) + i]);
+                res += utils::PieceToChar(state.mailbox[(j * 8) + i]);
                 ++i;
             }
         }
@@ -153,20 +235,123 @@ std::string Board::getFen() const
         res += castling + " ";
     }
 
-    if ( state->ep_field == 0ULL ) {
+    if ( state.ep_field == 0ULL ) {
         res += "- ";
     }
     else {
-        res += utils::square_to_coordinates[(get_LSB(state->ep_field))];
+        res += utils::square_to_coordinates[(get_LSB(state.ep_field))];
         res += " ";
     }
 
-    res += std::to_string(state->half_move_clock) + " ";
-    res += std::to_string(state->full_move_clock);
+    res += std::to_string(state.half_move_clock) + " ";
+    res += std::to_string(state.full_move_clock);
 
     return res;
 }
 
+Board Board::clone() const
+{
+    Board copy { Uninitialized {} };
+    copy.state = state;
+    copy.attack_map = attack_map;
+    if ( accumulators ) {
+        copy.accumulators = accumulators->cloneTop();
+    }
+
+    // oldest first, the newest key stays the last one in the ring
+    const uint32_t keys = std::min<uint32_t>({ static_cast<uint32_t>(state.half_move_clock), key_count, KEY_HISTORY_SIZE });
+    for ( uint32_t plies = keys; plies > 0; --plies ) {
+        copy.key_history[copy.key_count++] = key_history[(key_count - plies) % KEY_HISTORY_SIZE];
+    }
+
+    return copy;
+}
+
+PackedPosition Board::pack() const
+{
+    PackedPosition packed;
+
+    packed.occupancy = getOccupancy();
+    if ( get_bit_count(packed.occupancy) > PackedPosition::MAX_PIECES ) {
+        throw std::runtime_error("can not pack more than 32 pieces");
+    }
+
+    u64 occupancy = packed.occupancy;
+    for ( int i = 0; occupancy != 0ULL; ++i ) {
+        const int square = pop_LSB(occupancy);
+        packed.pieces[i >> 4] |= static_cast<uint64_t>(state.mailbox[square]) << ((i & 15) * 4);
+    }
+
+    packed.flags = static_cast<uint8_t>(!whiteTurn()) | static_cast<uint8_t>((state.castling_rights.raw & 0xF) << 1);
+    packed.ep_square = state.ep_field ? static_cast<uint8_t>(get_LSB(state.ep_field)) : PackedPosition::NO_EP;
+    packed.half_move = static_cast<uint8_t>(std::min(state.half_move_clock, 255));
+    packed.full_move = static_cast<uint16_t>(std::min(state.full_move_clock, 65535));
+
+    return packed;
+}
+
+void Board::unpack(const PackedPosition& packed)
+{
+    if ( !packed.isValid() ) {
+        throw std::runtime_error("invalid packed position");
+    }
+
+    clear();
+
+    // no templated placePiece here, the piece and color index come straight from the nibble
+    // bitboards, keys and scores are accumulated in locals, so the loop has no store to load chains through the state
+    std::array<u64, 14> pieces {};
+    u64 hash = 0ULL;
+    u64 pawn_hash = 0ULL;
+    Score psqt_score = 0;
+    int phase = 0;
+
+    u64 occupancy = packed.occupancy;
+    for ( int i = 0; occupancy != 0ULL; ++i ) {
+        const int square = pop_LSB(occupancy);
+        const int piece_index = static_cast<int>((packed.pieces[i >> 4] >> ((i & 15) * 4)) & 0xF);
+        const u64 mask = single_bit_u64(square);
+
+        state.mailbox[square] = static_cast<Piece>(piece_index);
+        pieces[piece_index] |= mask;
+        pieces[12 + (piece_index >= 6)] |= mask;
+
+        Zobrist::togglePiece(hash, piece_index, square);
+        if ( piece_index == getIndex(Piece::P) || piece_index == getIndex(Piece::p) ) {
+            Zobrist::togglePiece(pawn_hash, piece_index, square);
+        }
+
+        psqt_score += psqt::table[piece_index][square];
+        phase += psqt::phase_weight[piece_index];
+    }
+
+    state.pieces = pieces;
+    state.zobrist_hash = hash;
+    state.pawn_hash = pawn_hash;
+    state.psqt = psqt_score;
+    state.phase = phase;
+
+    if ( packed.flags & 1 ) {
+        state.cur_color = Color::black;
+        Zobrist::toggleBlackToMove(state.zobrist_hash);
+    }
+
+    state.castling_rights.raw = static_cast<char>((packed.flags >> 1) & 0xF);
+    Zobrist::updateCastling(state.zobrist_hash, 0x00, state.castling_rights.raw);
+
+    if ( packed.ep_square != PackedPosition::NO_EP ) {
+        state.ep_field = single_bit_u64(packed.ep_square);
+        Zobrist::toggleEnPassant(state.zobrist_hash, state.ep_field);
+    }
+
+    state.half_move_clock = packed.half_move;
+    state.full_move_clock = packed.full_move;
+
+    if ( attack_map ) {
+        attack_map->init(*this);
+    }
+}
+
 std::string Board::toString() const
 {
     const std::string BORDER = "+---+---+---+---+---+---+---+---+\n";
@@ -179,7 +364,7 @@ std::string Board::toString() const
         const unsigned row_begin = (rank - 1) * 8;
         for ( unsigned square = row_begin; square < row_begin + 8; ++square ) {
             str += ' ';
-            str += utils::PieceToChar(state->mailbox[square]);;
+            str += utils::PieceToChar(state.mailbox[square]);;
             str += " " + VERTICAL_BORDER;
         }
 
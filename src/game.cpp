@@ -1,5 +1,7 @@
 #include "game.h"
 
+PruningMargins pruning_margins;
+
 Game::Game(const std::string& fen)
 {
     if ( fen == "startpos" ) {
@@ -13,6 +15,9 @@ Game::Game(const std::string& fen)
             throw std::string("Failed to parse the fen!");
         }
     }
+
+    // the search evaluates with the network whenever one is loaded
+    board.setNnue(nnue::network.isLoaded());
 }
 
 void Game::make_move(const std::string& algebraic_move)
@@ -41,6 +46,8 @@ void Game::unmake_move(const std::string& algebraic_move)
 
 Move Game::bestMove(int depth)
 {
+    stats = SearchStats();
+
     if ( board.whiteTurn() ) {
         return getBestMove<Color::white>(board, depth);
     }
@@ -71,6 +78,37 @@ uint64_t Game::perftDetailEntry(int depth)
     }
 }
 
+Move Game::getHashMove(uint64_t key)
+{
+    // the entry might belong to another position, the picker validates the move before it is played
+    const auto entry = tt_eval.get(key);
+    return (entry.key == key) ? entry.best_move : Move();
+}
+
+void Game::storeKiller(int ply, const Move& move)
+{
+    auto& killers = search_stack[ply].killers;
+    if ( killers[0] != move ) {
+        killers[1] = killers[0];
+        killers[0] = move;
+    }
+}
+
+std::string Game::getPrincipalVariation() const
+{
+    const SearchFrame& root = search_stack[0];
+
+    std::string pv;
+    for ( int i = 0; i < root.pv_length; ++i ) {
+        if ( i > 0 ) {
+            pv += ' ';
+        }
+        pv += root.pv[i].toLongAlgebraic();
+    }
+
+    return pv;
+}
+
 Move Game::moveFromSring(const std::string& algebraic_move)
 {
     if ( algebraic_move.length() < 4 ) {
@@ -1,5 +1,6 @@
 #include "magic/magic.h"
 #include "config.h"
+#include <chrono>
 namespace magic {
     void storeMagicsToCppFile(const std::string& name, const std::array<Magic, 64>& magics);
 
@@ -4,25 +4,44 @@
 #include <string>
 #include <sstream>
 #include <cctype>
+#include <vector>
+#include <algorithm>
 
 #include "temp_cmd_manager.h"
 #include "move_generator/move_generation.h"
 #include "game.h"
 #include "config.h"
 #include "eval.h"
+#include "batch_eval.h"
+#include "tuner.h"
 
 void perft_test(const std::vector<std::string>& args);
 void detailed_perft_test(const std::vector<std::string>& args);
 void speed_test(const std::vector<std::string>& args);
 void debug_perft(const std::vector<std::string>& args);
+void attack_bench(const std::vector<std::string>& args);
+void eval_bench(const std::vector<std::string>& args);
+void tune(const std::vector<std::string>& args);
 void uci_interface();
+void attach_perft_cache(Game& game);
+
+// set by -perftcache <file>
+std::string perft_cache_path;
+std::string binary_path;
 
 int main(int argc, char** argv)
 {
     std::vector<std::string> args(argv, argv + argc);
     initializePrecomputedStuff();
 
-    if ( argc > 1 ) {
+    // -perftcache <file> in front of a perft mode keeps the perft table in that file between runs
+    if ( args.size() > 2 && args[1] == "-perftcache" ) {
+        perft_cache_path = args[2];
+        args.erase(args.begin() + 1, args.begin() + 3);
+    }
+    binary_path = args[0];
+
+    if ( args.size() > 1 ) {
         if ( args[1] == "-debug" ) {
             debug_perft(args);
         }
@@ -35,12 +54,25 @@ int main(int argc, char** argv)
         else if ( args[1] == "-perftd" ) {
             detailed_perft_test(args);
         }
+        else if ( args[1] == "-attackbench" ) {
+            attack_bench(args);
+        }
+        else if ( args[1] == "-evalbench" ) {
+            eval_bench(args);
+        }
+        else if ( args[1] == "-tune" ) {
+            tune(args);
+        }
         else {
             std::cout << "Usage:\n"
                 << "-test" << '\n'
+                << "[-perftcache <file>] -perft|-speed|-perftd|-debug ..." << '\n'
                 << "-perft <depth> [\"fen\"|startpos] <expected>" << '\n'
                 << "-speed <depth> [\"fen\"|startpos]" << '\n'
-                << "-perftd <depth> [\"fen\"|startpos]"
+                << "-perftd <depth> [\"fen\"|startpos]" << '\n'
+                << "-attackbench [\"fen\"|startpos]" << '\n'
+                << "-evalbench [\"fen\"|startpos]" << '\n'
+                << "-tune <file> [iterations] [learning rate]"
                 << '\n';
         }
     }
@@ -96,6 +128,7 @@ void detailed_perft_test(const std::vector<std::string>& args)
             << "usage: " << usage << '\n';
         return;
     }
+    attach_perft_cache(game);
 
     uint64_t nodes = game.perftDetailEntry(depth);
     std::cout << "Nodes searched: " << nodes << '\n';
@@ -131,6 +164,7 @@ void perft_test(const std::vector<std::string>& args)
             << "usage: " << usage << '\n';
         return;
     }
+    attach_perft_cache(game);
 
     uint64_t perft_result = game.perftSimpleEntry(depth);
 
@@ -187,6 +221,7 @@ void speed_test(const std::vector<std::string>& args)
             << "usage: " << usage << '\n';
         return;
     }
+    attach_perft_cache(game);
 
     auto begin = std::chrono::high_resolution_clock::now();
     uint64_t perft_result = game.perftSimpleEntry(depth);
@@ -230,6 +265,7 @@ void debug_perft(const std::vector<std::string>& args)
             << "usage: " << usage << '\n';
         return;
     }
+    attach_perft_cache(game);
 
     if ( args.size() > 4 ) {
         if ( args[4] != "moves" ) {
@@ -245,4 +281,270 @@ void debug_perft(const std::vector<std::string>& args)
 
     uint64_t nodes = game.perftDetailEntry(depth);
     std::cout << '\n' << nodes << '\n';
-}
\ No newline at end of file
+}
+
+// slider sets of one side, enough to compare the attack kernels without a board
+struct SliderSet {
+    u64 diagonal;
+    u64 orthogonal;
+    u64 occupancy;
+};
+
+template <Color color>
+static void collect_slider_sets(Board& board, int depth, std::vector<SliderSet>& sets)
+{
+    constexpr Color enemy = utils::switchColor(color);
+    const u64 occupancy = board.getOccupancy();
+    const u64 queens = board.getPieces<PieceType::queen, color>() | board.getPieces<PieceType::queen, enemy>();
+    const u64 bishops = board.getPieces<PieceType::bishop, color>() | board.getPieces<PieceType::bishop, enemy>();
+    const u64 rooks = board.getPieces<PieceType::rook, color>() | board.getPieces<PieceType::rook, enemy>();
+
+    sets.push_back({ bishops | queens, rooks | queens, occupancy });
+
+    if ( depth == 0 ) {
+        return;
+    }
+
+    MoveList list;
+    generate_moves<color>(list, board);
+    for ( const Move& move : list ) {
+        board.move<color>(move);
+        collect_slider_sets<enemy>(board, depth - 1, sets);
+        board.undo<color>(move);
+    }
+}
+
+template <typename Kernel>
+static void time_kernel(const std::string& name, const std::vector<SliderSet>& sets, int rounds, Kernel&& kernel)
+{
+    u64 checksum = 0ULL;
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    for ( int i = 0; i < rounds; ++i ) {
+        for ( const auto& set : sets ) {
+            checksum += kernel(set);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const double ns = std::chrono::duration<double, std::nano>(end - begin).count() / (static_cast<double>(rounds) * sets.size());
+    std::cout << std::left << std::setw(COL_SPACING) << name << std::fixed << std::setprecision(2) << ns << " ns/call"
+        << "  (checksum " << std::hex << checksum << std::dec << ")\n";
+}
+
+// -attackbench ["fen"|startpos]
+void attack_bench(const std::vector<std::string>& args)
+{
+    const static std::string usage = "-attackbench [\"fen\"|startpos]";
+    if ( args.size() > 3 ) {
+        std::cout << "usage: " << usage << '\n';
+        return;
+    }
+
+    const std::string fen = (args.size() == 3 && args[2] != "startpos") ? args[2] : STARTPOS;
+
+    // all positions up to 2 plies from the root, the sliders of both sides are attacking
+    std::vector<SliderSet> sets;
+    try {
+        Board board(fen);
+        if ( board.whiteTurn() ) {
+            collect_slider_sets<Color::white>(board, 2, sets);
+        }
+        else {
+            collect_slider_sets<Color::black>(board, 2, sets);
+        }
+    }
+    catch ( std::exception& e ) {
+        std::cout << "Failed to parse the fen!\n"
+            << "usage: " << usage << '\n';
+        return;
+    }
+
+    auto magic = [](const SliderSet& set) {
+        return sliders::getBitboard<PieceType::bishop>(set.diagonal, set.occupancy)
+            | sliders::getBitboard<PieceType::rook>(set.orthogonal, set.occupancy);
+    };
+
+    for ( const auto& set : sets ) {
+        const u64 expected = magic(set);
+        bool equal = expected == kogge_stone::attacksScalar(set.diagonal, set.orthogonal, set.occupancy);
+#if defined(__AVX2__)
+        equal = equal && expected == kogge_stone::attacksAvx2(set.diagonal, set.orthogonal, set.occupancy);
+#endif
+        if ( !equal ) {
+            std::cout << RED << "kernels disagree!" << RESET << '\n';
+            return;
+        }
+    }
+
+    const int rounds = std::max(1, static_cast<int>(20'000'000 / sets.size()));
+    std::cout << sets.size() << " positions, " << rounds << " rounds\n";
+
+    time_kernel("magic", sets, rounds, magic);
+    time_kernel("kogge-stone", sets, rounds, [](const SliderSet& set) {
+        return kogge_stone::attacksScalar(set.diagonal, set.orthogonal, set.occupancy);
+    });
+#if defined(__AVX2__)
+    time_kernel("kogge-stone avx2", sets, rounds, [](const SliderSet& set) {
+        return kogge_stone::attacksAvx2(set.diagonal, set.orthogonal, set.occupancy);
+    });
+#endif
+}
+
+template <Color color>
+static void collect_positions(Board& board, int depth, std::vector<PackedPosition>& positions)
+{
+    positions.push_back(board.pack());
+
+    if ( depth == 0 ) {
+        return;
+    }
+
+    MoveList list;
+    generate_moves<color>(list, board);
+    for ( const Move& move : list ) {
+        board.move<color>(move);
+        collect_positions<utils::switchColor(color)>(board, depth - 1, positions);
+        board.undo<color>(move);
+    }
+}
+
+// -evalbench ["fen"|startpos]
+void eval_bench(const std::vector<std::string>& args)
+{
+    const static std::string usage = "-evalbench [\"fen\"|startpos]";
+    if ( args.size() > 3 ) {
+        std::cout << "usage: " << usage << '\n';
+        return;
+    }
+
+    const std::string fen = (args.size() == 3 && args[2] != "startpos") ? args[2] : STARTPOS;
+
+    // all positions up to 4 plies from the root
+    std::vector<PackedPosition> positions;
+    try {
+        Board board(fen);
+        if ( board.whiteTurn() ) {
+            collect_positions<Color::white>(board, 4, positions);
+        }
+        else {
+            collect_positions<Color::black>(board, 4, positions);
+        }
+    }
+    catch ( std::exception& e ) {
+        std::cout << "Failed to parse the fen!\n"
+            << "usage: " << usage << '\n';
+        return;
+    }
+
+    std::vector<double> expected(positions.size());
+    std::vector<double> scores(positions.size());
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    Board board;
+    for ( size_t i = 0; i < positions.size(); ++i ) {
+        board.unpack(positions[i]);
+        expected[i] = board.whiteTurn() ? evalPosition<Color::white>(board) : evalPosition<Color::black>(board);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const double single_ns = std::chrono::duration<double, std::nano>(end - begin).count() / positions.size();
+
+    auto time_batch = [&](unsigned threads) {
+        auto batch_begin = std::chrono::high_resolution_clock::now();
+        batch_eval::evaluate(positions, scores, threads);
+        auto batch_end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::nano>(batch_end - batch_begin).count() / positions.size();
+    };
+
+    const double batch_ns = time_batch(1);
+    if ( scores != expected ) {
+        std::cout << RED << "batch eval disagrees!" << RESET << '\n';
+        return;
+    }
+
+    const double threaded_ns = time_batch(0);
+    if ( scores != expected ) {
+        std::cout << RED << "threaded batch eval disagrees!" << RESET << '\n';
+        return;
+    }
+
+    std::cout << positions.size() << " positions\n" << std::fixed << std::setprecision(2)
+        << std::left << std::setw(COL_SPACING) << "unpack + eval" << single_ns << " ns/position\n"
+        << std::left << std::setw(COL_SPACING) << "batch" << batch_ns << " ns/position\n"
+        << std::left << std::setw(COL_SPACING) << "batch threaded" << threaded_ns << " ns/position\n";
+}
+
+// -tune <file> [iterations] [learning rate]
+void tune(const std::vector<std::string>& args)
+{
+    const static std::string usage = "-tune <file> [iterations] [learning rate]";
+    if ( args.size() < 3 || args.size() > 5 ) {
+        std::cout << "usage: " << usage << '\n';
+        return;
+    }
+
+    int iterations = 1000;
+    double learning_rate = 1.0;
+    try {
+        if ( args.size() > 3 ) {
+            iterations = std::stoi(args[3]);
+        }
+        if ( args.size() > 4 ) {
+            learning_rate = std::stod(args[4]);
+        }
+    }
+    catch ( std::exception& e ) {
+        std::cout << "\'iterations\' and \'learning rate\' must be numbers!\n"
+            << "usage: " << usage << '\n';
+        return;
+    }
+
+    tuner::Dataset data;
+    try {
+        data = tuner::load(args[2]);
+    }
+    catch ( std::exception& e ) {
+        std::cout << e.what() << '\n'
+            << "usage: " << usage << '\n';
+        return;
+    }
+
+    if ( data.size() == 0 ) {
+        std::cout << "no labelled positions in " << args[2] << '\n';
+        return;
+    }
+
+    tuner::Parameters parameters = tuner::currentParameters();
+    const double k = tuner::fitScalingConstant(data, parameters);
+    std::cout << "K = " << k << ", error " << std::fixed << std::setprecision(8) << tuner::error(data, parameters, k) << '\n';
+
+    tuner::tune(data, parameters, k, iterations, learning_rate);
+
+    std::cout << '\n' << tuner::toTables(parameters);
+}
+
+// maps the perft table of the game to the file of -perftcache, a perft without it still works
+void attach_perft_cache(Game& game)
+{
+    if ( perft_cache_path.empty() ) {
+        return;
+    }
+
+    try {
+        // our own binary, /proc is not there on every system
+        static const uint64_t fingerprint = [] {
+            try {
+                return PerftFile::fingerprint("/proc/self/exe");
+            }
+            catch ( std::exception& e ) {
+                return PerftFile::fingerprint(binary_path);
+            }
+        }();
+
+        const bool warm = game.usePerftCache(perft_cache_path, fingerprint);
+        std::cerr << "perft cache " << perft_cache_path << (warm ? " (warm)" : " (new)") << '\n';
+    }
+    catch ( std::exception& e ) {
+        std::cerr << e.what() << ", running without the perft cache\n";
+    }
+}
@@ -0,0 +1,92 @@
+#include "nnue/nnue.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nnue {
+
+Network network;
+
+void Network::load(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+        throw std::runtime_error("could not open " + path);
+    }
+
+    struct stat info;
+    if ( fstat(fd, &info) != 0 ) {
+        close(fd);
+        throw std::runtime_error("could not stat " + path);
+    }
+
+    if ( static_cast<size_t>(info.st_size) != fileSize() ) {
+        close(fd);
+        throw std::runtime_error(path + " is not a network of this engine (wrong size)");
+    }
+
+    void* new_mapping = mmap(nullptr, fileSize(), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( new_mapping == MAP_FAILED ) {
+        throw std::runtime_error("could not map " + path);
+    }
+
+    const char* data = static_cast<const char*>(new_mapping);
+
+    uint32_t header[5];
+    std::memcpy(header, data + 8, sizeof(header));
+    const bool valid = std::memcmp(data, "SLOUNNUE", 8) == 0 && header[0] == VERSION
+        && header[1] == INPUT_DIMENSIONS && header[2] == HALF_DIMENSIONS
+        && header[3] == L1_DIMENSIONS && header[4] == L2_DIMENSIONS;
+
+    if ( !valid ) {
+        munmap(new_mapping, fileSize());
+        throw std::runtime_error(path + " is not a network of this engine (wrong header)");
+    }
+
+    unload();
+    mapping = new_mapping;
+    mapping_size = fileSize();
+
+    // every section starts 64 byte aligned, the header is 64 bytes and every size before the last two is a multiple of 64
+    data += 64;
+    ft_bias = reinterpret_cast<const int16_t*>(data);
+    data += sizeof(int16_t) * HALF_DIMENSIONS;
+    ft_weights = reinterpret_cast<const int16_t*>(data);
+    data += sizeof(int16_t) * HALF_DIMENSIONS * static_cast<size_t>(INPUT_DIMENSIONS);
+    l1_bias = reinterpret_cast<const int32_t*>(data);
+    data += sizeof(int32_t) * L1_DIMENSIONS;
+    l1_weights = reinterpret_cast<const int8_t*>(data);
+    data += L1_DIMENSIONS * 2 * HALF_DIMENSIONS;
+    l2_bias = reinterpret_cast<const int32_t*>(data);
+    data += sizeof(int32_t) * L2_DIMENSIONS;
+    l2_weights = reinterpret_cast<const int8_t*>(data);
+    data += L2_DIMENSIONS * L1_DIMENSIONS;
+    out_weights = reinterpret_cast<const int8_t*>(data);
+    data += L2_DIMENSIONS;
+    std::memcpy(&out_bias, data, sizeof(out_bias));
+
+    // the feature weights are read at random, the rest is small
+    madvise(mapping, mapping_size, MADV_WILLNEED);
+}
+
+void Network::unload()
+{
+    if ( mapping ) {
+        munmap(mapping, mapping_size);
+    }
+
+    mapping = nullptr;
+    mapping_size = 0;
+    ft_bias = ft_weights = nullptr;
+    l1_bias = l2_bias = nullptr;
+    l1_weights = l2_weights = out_weights = nullptr;
+    out_bias = 0;
+}
+
+} // namespace nnue
@@ -0,0 +1,111 @@
+#include "perft_table.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct PerftFileHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t table_size;
+    uint64_t fingerprint;
+    std::array<uint8_t, 32> unused;
+};
+
+static_assert(sizeof(PerftFileHeader) == 64, "the buckets behind the header stay aligned to a cache line");
+
+constexpr std::array<char, 8> PERFT_FILE_MAGIC = { 's', 'l', 'o', 'u', 'p', 'e', 'r', 'f' };
+constexpr uint32_t PERFT_FILE_VERSION = 1;
+
+} // namespace
+
+PerftFile::PerftFile(const std::string& path, size_t table_size, uint64_t fingerprint)
+{
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if ( fd < 0 ) {
+        throw std::runtime_error("could not open " + path);
+    }
+
+    struct stat info;
+    if ( fstat(fd, &info) != 0 ) {
+        close(fd);
+        throw std::runtime_error("could not stat " + path);
+    }
+
+    mapping_size = sizeof(PerftFileHeader) + table_size;
+    if ( static_cast<size_t>(info.st_size) != mapping_size && ftruncate(fd, static_cast<off_t>(mapping_size)) != 0 ) {
+        close(fd);
+        throw std::runtime_error("could not resize " + path);
+    }
+
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if ( mapping == MAP_FAILED ) {
+        mapping = nullptr;
+        close(fd);
+        throw std::runtime_error("could not map " + path);
+    }
+
+    // the mapping stays valid without the descriptor
+    close(fd);
+
+    const PerftFileHeader expected = {
+        PERFT_FILE_MAGIC, PERFT_FILE_VERSION, static_cast<uint32_t>(sizeof(PerftEntry)), table_size, fingerprint, {}
+    };
+
+    // a new file, a resized one or one of another binary, the header goes in last so a cleared table is never valid early
+    PerftFileHeader& header = *static_cast<PerftFileHeader*>(mapping);
+    warm = std::memcmp(&header, &expected, sizeof(PerftFileHeader)) == 0;
+    if ( !warm ) {
+        std::memset(data(), 0, table_size);
+        header = expected;
+    }
+}
+
+PerftFile::~PerftFile()
+{
+    if ( mapping ) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+void* PerftFile::data() const
+{
+    return static_cast<char*>(mapping) + sizeof(PerftFileHeader);
+}
+
+uint64_t PerftFile::fingerprint(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+        throw std::runtime_error("could not open " + path);
+    }
+
+    struct stat info;
+    if ( fstat(fd, &info) != 0 || info.st_size == 0 ) {
+        close(fd);
+        throw std::runtime_error("could not stat " + path);
+    }
+
+    const size_t size = static_cast<size_t>(info.st_size);
+    void* file = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( file == MAP_FAILED ) {
+        throw std::runtime_error("could not map " + path);
+    }
+
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    const unsigned char* bytes = static_cast<const unsigned char*>(file);
+    for ( size_t i = 0; i < size; ++i ) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+
+    munmap(file, size);
+    return hash;
+}
@@ -0,0 +1,82 @@
+#include "position_loader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+PositionLoader::PositionLoader(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+        throw std::runtime_error("could not open " + path);
+    }
+
+    struct stat info;
+    if ( fstat(fd, &info) != 0 ) {
+        close(fd);
+        throw std::runtime_error("could not stat " + path);
+    }
+
+    mapping_size = static_cast<size_t>(info.st_size);
+    if ( mapping_size > 0 ) {
+        mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if ( mapping == MAP_FAILED ) {
+            mapping = nullptr;
+            close(fd);
+            throw std::runtime_error("could not map " + path);
+        }
+
+        madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+        buffer = std::string_view(static_cast<const char*>(mapping), mapping_size);
+    }
+
+    // the mapping stays valid without the descriptor
+    close(fd);
+}
+
+PositionLoader::~PositionLoader()
+{
+    if ( mapping ) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+bool PositionLoader::next(Board& board)
+{
+    while ( offset < buffer.size() ) {
+        size_t end = buffer.find('\n', offset);
+        if ( end == std::string_view::npos ) {
+            end = buffer.size();
+        }
+
+        std::string_view current = buffer.substr(offset, end - offset);
+        offset = end + 1;
+
+        while ( !current.empty() && (current.back() == '\r' || current.back() == ' ' || current.back() == '\t') ) {
+            current.remove_suffix(1);
+        }
+        while ( !current.empty() && (current.front() == ' ' || current.front() == '\t') ) {
+            current.remove_prefix(1);
+        }
+
+        if ( current.empty() || current.front() == '#' ) {
+            continue;
+        }
+
+        line = current;
+        operations = std::string_view();
+
+        const size_t fen_length = board.setFen(line);
+
+        operations = line.substr(fen_length);
+        while ( !operations.empty() && (operations.front() == ' ' || operations.front() == '\t') ) {
+            operations.remove_prefix(1);
+        }
+
+        ++count;
+        return true;
+    }
+
+    return false;
+}
@@ -1,4 +1,7 @@
 #include "temp_cmd_manager.h"
+
+#include <algorithm>
+
 #include "game.h"
 
 template <Color color>
@@ -108,8 +111,46 @@ void CommandManager::parseCommand()
         else if ( token == "uci" ) {
             std::cout << "id name slou 1.1\n"
                 << "id author amazzetta\n\n"
+                << "option name EvalFile type string default <empty>\n"
+                << "option name ReverseFutilityMargin type spin default " << pruning_margins.reverse_futility << " min 0 max 1000\n"
+                << "option name RazoringMargin type spin default " << pruning_margins.razoring << " min 0 max 1000\n"
+                << "option name FutilityMargin type spin default " << pruning_margins.futility << " min 0 max 1000\n"
                 << "uciok\n";
         }
+        else if ( token == "setoption" ) {
+            // setoption name <id> value <x>
+            std::string name, value;
+            ss >> token >> name >> token;
+            std::getline(ss >> std::ws, value);
+
+            if ( name == "EvalFile" ) {
+                try {
+                    nnue::network.load(value);
+                    // a new game, so the board starts keeping accumulators for the new network
+                    game = Game();
+                    _fen = STARTPOS;
+                    std::cout << "info string loaded network " << value << '\n';
+                }
+                catch ( std::exception& e ) {
+                    std::cout << "info string " << e.what() << '\n';
+                }
+            }
+            else if ( name == "ReverseFutilityMargin" || name == "RazoringMargin" || name == "FutilityMargin" ) {
+                int& margin = name == "ReverseFutilityMargin" ? pruning_margins.reverse_futility
+                    : name == "RazoringMargin" ? pruning_margins.razoring
+                    : pruning_margins.futility;
+                try {
+                    // the range advertised by uci
+                    margin = std::clamp(std::stoi(value), 0, 1000);
+                }
+                catch ( std::exception& ) {
+                    std::cout << "info string invalid value for " << name << ": " << value << '\n';
+                }
+            }
+            else {
+                std::cout << "unknown option: " << name << '\n';
+            }
+        }
         else if ( token == "stop" ) {
             //quit = true;
         }
@@ -153,6 +194,12 @@ void CommandManager::parseCommand()
             else {
             here:
                 Move best_move = game.bestMove();
+                const SearchStats& stats = game.getStats();
+                std::cout << "info nodes " << stats.nodes << " pv " << game.getPrincipalVariation() << '\n';
+                std::cout << "info string eval full " << stats.eval.full << " lazy " << stats.eval.lazy
+                    << " saved " << stats.eval.savedMilliseconds() << " ms\n";
+                std::cout << "info string pruned reverse futility " << stats.reverse_futility << " razoring " << stats.razoring
+                    << " futility " << stats.futility << '\n';
                 std::cout << "bestmove " << best_move.toLongAlgebraic() << '\n';
             }
         }
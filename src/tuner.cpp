@@ -0,0 +1,453 @@
+#include "tuner.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "bitboard.h"
+#include "config.h"
+#include "eval.h"
+#include "move_generator/move_picker.h"
+#include "position_loader.h"
+#include "psqt.h"
+#include "quiescence.h"
+#include "search_stack.h"
+
+namespace tuner {
+
+namespace {
+
+// the quiescence search gives up after this many captures in a row and keeps the position it reached
+constexpr int QUIESCENCE_PLY = 32;
+
+unsigned threadCount(unsigned threads, size_t work)
+{
+    if ( threads == 0 ) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    return static_cast<unsigned>(std::clamp<size_t>(work, 1, threads));
+}
+
+/**
+ * @brief   Split [0, size) into one contiguous range per thread, the calling thread takes the first one.
+ *
+ * @param size
+ * @param threads
+ * @param function  called with (thread index, begin, end)
+ */
+template <typename Function>
+void parallelFor(size_t size, unsigned threads, Function&& function)
+{
+    threads = threadCount(threads, size);
+    const size_t step = (size + threads - 1) / threads;
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for ( unsigned t = 1; t < threads; ++t ) {
+        pool.emplace_back([&, t]() { function(t, std::min(size, t * step), std::min(size, (t + 1) * step)); });
+    }
+
+    function(0u, size_t(0), std::min(size, step));
+
+    for ( auto& thread : pool ) {
+        thread.join();
+    }
+}
+
+/**
+ * @brief   The result of a labelled line.
+ *
+ * @param operations    everything after the fen
+ * @param result        half points for white
+ * @return true         if there was a result
+ */
+bool parseResult(std::string_view operations, uint8_t& result)
+{
+    // before "1-0" and "0-1", they are part of "1/2-1/2"
+    if ( operations.find("1/2-1/2") != std::string_view::npos ) {
+        result = 1;
+        return true;
+    }
+    if ( operations.find("1-0") != std::string_view::npos ) {
+        result = 2;
+        return true;
+    }
+    if ( operations.find("0-1") != std::string_view::npos ) {
+        result = 0;
+        return true;
+    }
+
+    const size_t open = operations.find('[');
+    if ( open == std::string_view::npos ) {
+        return false;
+    }
+
+    const std::string_view score = operations.substr(open + 1, 3);
+    if ( score.starts_with("0.5") ) {
+        result = 1;
+    }
+    else if ( score.starts_with('1') ) {
+        result = 2;
+    }
+    else if ( score.starts_with('0') ) {
+        result = 0;
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+// everything the eval needs from a position, in terms of the parameters
+struct Features {
+    // index into the parameters (the midgame one, the endgame one follows) and +1 for white, -1 for black
+    std::array<uint16_t, PackedPosition::MAX_PIECES> index;
+    std::array<int8_t, PackedPosition::MAX_PIECES> sign;
+    int count = 0;
+
+    // midgame weight out of psqt::MAX_PHASE
+    int phase = 0;
+};
+
+// the positions of a dataset all come from Board::pack, so they have at most MAX_PIECES pieces
+inline void extract(const PackedPosition& packed, Features& features)
+{
+    assert(std::popcount(packed.occupancy) <= PackedPosition::MAX_PIECES && "a packed position has at most 32 pieces");
+
+    features.count = 0;
+    features.phase = 0;
+
+    u64 occupancy = packed.occupancy;
+    for ( int n = 0; occupancy != 0ULL; ++n ) {
+        const int square = pop_LSB(occupancy);
+        const int piece = static_cast<int>((packed.pieces[n >> 4] >> ((n & 15) * 4)) & 0xF);
+        const bool white = piece < 6;
+        const int type = white ? piece : piece - 6;
+
+        // same orientation as psqt::generateTable
+        const int table_index = white ? square ^ 56 : square;
+
+        features.index[features.count] = static_cast<uint16_t>((type * 64 + table_index) * 2);
+        features.sign[features.count] = white ? 1 : -1;
+        ++features.count;
+
+        features.phase += psqt::phase_weight[piece];
+    }
+
+    features.phase = std::min(features.phase, psqt::MAX_PHASE);
+}
+
+// the tuned part of the eval from white's view, like the piece square part of evalPosition<Color::white> but without rounding
+inline double evaluate(const Features& features, const Parameters& parameters)
+{
+    double mg = 0.0;
+    double eg = 0.0;
+    for ( int i = 0; i < features.count; ++i ) {
+        mg += features.sign[i] * parameters[features.index[i]];
+        eg += features.sign[i] * parameters[features.index[i] + 1];
+    }
+
+    return (mg * features.phase + eg * (psqt::MAX_PHASE - features.phase)) / psqt::MAX_PHASE;
+}
+
+inline double sigmoid(double k, double score)
+{
+    return 1.0 / (1.0 + std::pow(10.0, -k * score / 400.0));
+}
+
+// the side that is not to move must not be in check, the quiescence search would capture its king
+bool isLegalPosition(const Board& board)
+{
+    const u64 white_king = board.getPieces<PieceType::king, Color::white>();
+    const u64 black_king = board.getPieces<PieceType::king, Color::black>();
+    if ( std::popcount(white_king) != 1 || std::popcount(black_king) != 1 ) {
+        return false;
+    }
+
+    if ( board.whiteTurn() ) {
+        return !attackers_to<Color::white>(board, get_LSB(black_king), board.getOccupancy());
+    }
+
+    return !attackers_to<Color::black>(board, get_LSB(white_king), board.getOccupancy());
+}
+
+} // namespace
+
+Dataset load(const std::string& path, unsigned threads)
+{
+    Dataset data;
+    PositionLoader loader(path);
+
+    Board board;
+    size_t skipped = 0;
+    for ( ;; ) {
+        try {
+            if ( !loader.next(board) ) {
+                break;
+            }
+        }
+        catch ( std::exception& e ) {
+            ++skipped;
+            continue;
+        }
+
+        uint8_t result;
+        if ( !parseResult(loader.getOperations(), result) || !isLegalPosition(board) ) {
+            ++skipped;
+            continue;
+        }
+
+        data.positions.push_back(board.pack());
+        data.results.push_back(result);
+    }
+
+    std::cout << "loaded " << data.size() << " positions";
+    if ( skipped > 0 ) {
+        std::cout << ", skipped " << skipped << " lines without a legal fen or a result";
+    }
+    std::cout << '\n';
+
+    // resolve in place, every thread has its own board and search stack
+    data.fixed_scores.resize(data.size());
+    const auto begin = std::chrono::steady_clock::now();
+    parallelFor(data.size(), threads, [&](unsigned, size_t first, size_t last) {
+        Board local;
+        SearchStack stack;
+        // the handcrafted eval, the window does not matter to it
+        auto eval = []<Color side>(Board& board, double, double) { return static_cast<double>(evalPosition<side>(board)); };
+        for ( size_t i = first; i < last; ++i ) {
+            local.unpack(data.positions[i]);
+
+            PackedPosition leaf;
+            if ( local.whiteTurn() ) {
+                quiescence<Color::white>(local, stack, 0, QUIESCENCE_PLY, -INFTY, INFTY, eval, &leaf);
+            }
+            else {
+                quiescence<Color::black>(local, stack, 0, QUIESCENCE_PLY, -INFTY, INFTY, eval, &leaf);
+            }
+
+            data.positions[i] = leaf;
+
+            // everything but the piece square values stays as it is
+            local.unpack(leaf);
+            const Score activity = evalActivity(local);
+            const int phase = std::min(local.getPhase(), psqt::MAX_PHASE);
+            const int tapered = (mg_value(activity) * phase + eg_value(activity) * (psqt::MAX_PHASE - phase)) / psqt::MAX_PHASE;
+            data.fixed_scores[i] = static_cast<int16_t>(tapered + getPawnScore(local));
+        }
+    });
+    const auto end = std::chrono::steady_clock::now();
+
+    std::cout << "resolved the positions with quiescence in "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << "ms\n";
+
+    return data;
+}
+
+Parameters currentParameters()
+{
+    constexpr std::array<const psqt::Table*, 6> mg = { &psqt::pawn_mg, &psqt::knight_mg, &psqt::bishop_mg, &psqt::rook_mg, &psqt::queen_mg, &psqt::king_mg };
+    constexpr std::array<const psqt::Table*, 6> eg = { &psqt::pawn_eg, &psqt::knight_eg, &psqt::bishop_eg, &psqt::rook_eg, &psqt::queen_eg, &psqt::king_eg };
+
+    Parameters parameters(PARAMETER_COUNT);
+    for ( int type = 0; type < 6; ++type ) {
+        for ( int index = 0; index < 64; ++index ) {
+            parameters[(type * 64 + index) * 2] = mg_value(psqt::material[type]) + (*mg[type])[index];
+            parameters[(type * 64 + index) * 2 + 1] = eg_value(psqt::material[type]) + (*eg[type])[index];
+        }
+    }
+
+    return parameters;
+}
+
+double error(const Dataset& data, const Parameters& parameters, double k, unsigned threads)
+{
+    const unsigned count = threadCount(threads, data.size());
+    std::vector<double> sums(count, 0.0);
+
+    parallelFor(data.size(), count, [&](unsigned t, size_t first, size_t last) {
+        Features features;
+        double sum = 0.0;
+        for ( size_t i = first; i < last; ++i ) {
+            extract(data.positions[i], features);
+            const double diff = data.results[i] / 2.0 - sigmoid(k, evaluate(features, parameters) + data.fixed_scores[i]);
+            sum += diff * diff;
+        }
+        sums[t] = sum;
+    });
+
+    double total = 0.0;
+    for ( const double sum : sums ) {
+        total += sum;
+    }
+
+    return total / std::max<size_t>(data.size(), 1);
+}
+
+double fitScalingConstant(const Dataset& data, const Parameters& parameters, unsigned threads)
+{
+    // the error is convex in K, narrow it down one decimal place at a time
+    double best_k = 1.0;
+    double best_error = error(data, parameters, best_k, threads);
+
+    for ( double step = 1.0; step >= 0.001; step /= 10.0 ) {
+        const double center = best_k;
+        for ( int i = -9; i <= 9; ++i ) {
+            const double k = center + i * step;
+            if ( k <= 0.0 ) {
+                continue;
+            }
+
+            const double e = error(data, parameters, k, threads);
+            if ( e < best_error ) {
+                best_error = e;
+                best_k = k;
+            }
+        }
+    }
+
+    return best_k;
+}
+
+void tune(const Dataset& data, Parameters& parameters, double k, int iterations, double learning_rate, unsigned threads)
+{
+    constexpr double BETA_1 = 0.9;
+    constexpr double BETA_2 = 0.999;
+    constexpr double EPSILON = 1e-8;
+
+    const unsigned count = threadCount(threads, data.size());
+    std::vector<Parameters> gradients(count, Parameters(PARAMETER_COUNT));
+    Parameters momentum(PARAMETER_COUNT, 0.0);
+    Parameters velocity(PARAMETER_COUNT, 0.0);
+
+    // d sigmoid(k * x) / dx = ln(10) * k / 400 * s * (1 - s)
+    const double scale = std::log(10.0) * k / 400.0;
+
+    for ( int iteration = 1; iteration <= iterations; ++iteration ) {
+        const auto begin = std::chrono::steady_clock::now();
+        std::vector<double> errors(count, 0.0);
+
+        parallelFor(data.size(), count, [&](unsigned t, size_t first, size_t last) {
+            Parameters& gradient = gradients[t];
+            std::fill(gradient.begin(), gradient.end(), 0.0);
+
+            Features features;
+            double sum = 0.0;
+            for ( size_t i = first; i < last; ++i ) {
+                extract(data.positions[i], features);
+                const double s = sigmoid(k, evaluate(features, parameters) + data.fixed_scores[i]);
+                const double diff = data.results[i] / 2.0 - s;
+                sum += diff * diff;
+
+                // d (r - s)^2 / d eval, then split by phase
+                const double d_eval = -2.0 * diff * scale * s * (1.0 - s);
+                const double d_mg = d_eval * features.phase / psqt::MAX_PHASE;
+                const double d_eg = d_eval * (psqt::MAX_PHASE - features.phase) / psqt::MAX_PHASE;
+
+                for ( int f = 0; f < features.count; ++f ) {
+                    gradient[features.index[f]] += features.sign[f] * d_mg;
+                    gradient[features.index[f] + 1] += features.sign[f] * d_eg;
+                }
+            }
+            errors[t] = sum;
+        });
+
+        double total_error = 0.0;
+        for ( unsigned t = 0; t < count; ++t ) {
+            total_error += errors[t];
+        }
+
+        const double correction_1 = 1.0 - std::pow(BETA_1, iteration);
+        const double correction_2 = 1.0 - std::pow(BETA_2, iteration);
+        for ( int p = 0; p < PARAMETER_COUNT; ++p ) {
+            double g = 0.0;
+            for ( unsigned t = 0; t < count; ++t ) {
+                g += gradients[t][p];
+            }
+            g /= static_cast<double>(data.size());
+
+            momentum[p] = BETA_1 * momentum[p] + (1.0 - BETA_1) * g;
+            velocity[p] = BETA_2 * velocity[p] + (1.0 - BETA_2) * g * g;
+            parameters[p] -= learning_rate * (momentum[p] / correction_1) / (std::sqrt(velocity[p] / correction_2) + EPSILON);
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(end - begin).count();
+
+        // the error is the one before this step
+        std::cout << "iteration " << std::setw(5) << iteration
+            << "  error " << std::fixed << std::setprecision(8) << total_error / data.size()
+            << "  " << std::setprecision(2) << data.size() / seconds / 1e6 << "M positions/s\n";
+    }
+}
+
+std::string toTables(const Parameters& parameters)
+{
+    static const std::array<std::string, 6> names = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+
+    std::array<std::array<int, 2>, 6> material {};
+    for ( int type = 0; type < 6; ++type ) {
+        // the king has no material, both sides always have one, so any offset of its table cancels out
+        if ( type == 5 ) {
+            continue;
+        }
+
+        for ( int phase = 0; phase < 2; ++phase ) {
+            double sum = 0.0;
+            int squares = 0;
+            for ( int index = 0; index < 64; ++index ) {
+                // pawns never stand on the first and last row
+                if ( type == 0 && (index < 8 || index >= 56) ) {
+                    continue;
+                }
+
+                sum += parameters[(type * 64 + index) * 2 + phase];
+                ++squares;
+            }
+
+            material[type][phase] = static_cast<int>(std::lround(sum / squares));
+        }
+    }
+
+    std::ostringstream out;
+    out << "constexpr std::array<Score, 7> material = {\n    ";
+    for ( int type = 0; type < 6; ++type ) {
+        out << "S(" << material[type][0] << ", " << material[type][1] << "), ";
+    }
+    out << "S(0, 0)\n};\n";
+
+    for ( int type = 0; type < 6; ++type ) {
+        for ( int phase = 0; phase < 2; ++phase ) {
+            out << "\nconstexpr Table " << names[type] << (phase == 0 ? "_mg" : "_eg") << " = {\n";
+            for ( int row = 0; row < 8; ++row ) {
+                out << "    ";
+                for ( int file = 0; file < 8; ++file ) {
+                    const int index = row * 8 + file;
+                    int value = 0;
+                    if ( type != 0 || (index >= 8 && index < 56) ) {
+                        value = static_cast<int>(std::lround(parameters[(type * 64 + index) * 2 + phase])) - material[type][phase];
+                    }
+
+                    out << std::setw(4) << value << (index == 63 ? "" : ",");
+                }
+                out << '\n';
+            }
+            out << "};\n";
+        }
+    }
+
+    return out.str();
+}
+
+} // namespace tuner
@@ -165,6 +165,12 @@ NAME="slou"
 ENGINE="$(dirname "$0")/bin/$NAME"
 COMMAND="-perft"
 
+# set PERFT_CACHE to a file to keep the perft tables between runs (see -perftcache), a rebuilt engine starts over
+CACHE_ARGS=()
+if [ -n "$PERFT_CACHE" ]; then
+    CACHE_ARGS=(-perftcache "$PERFT_CACHE")
+fi
+
 FORMAT_PRINT="%-10s %-15s %-15s %s"
 FORMAT_RESULTS="%-10s %-10s"
 
@@ -206,7 +212,7 @@ for test in "${tests[@]}"; do
 
     # run the test and measure the execution time in ns
     start=$(gdate +%s%N)
-    output=$($ENGINE $COMMAND "$depth" "$fen" "$expected" 2>&1)             # run the testcase
+    output=$($ENGINE "${CACHE_ARGS[@]}" $COMMAND "$depth" "$fen" "$expected" 2>&1) # run the testcase
     end=$(gdate +%s%N)
     total_time=$(echo "$total_time + $(echo "$end - $start" | bc)" | bc)    # accumulate the duration to the total
 